@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+#
+# Generates, builds and runs a parser which parses each line of the input as a separate document,
+# and compares the latency per document of creating a context for each document with that of
+# reusing one context by resetting it.
+#
+# Usage:
+#   ./reuse.sh [input] [rounds]
+#
+# Environment:
+#   CC              Compiler to use, default: "cc -O2"
+#
+# Example:
+#   CC="clang -O3" ./reuse.sh inputs/calc.txt 1000
+
+main() {
+    set -e
+
+    BENCHDIR="$(cd "$(dirname "$0")" && pwd)"
+    ROOTDIR="$BENCHDIR/.."
+    CC="${CC:-cc -O2}"
+    INPUT="${1:-$BENCHDIR/inputs/calc.txt}"
+    ROUNDS="${2:-100}"
+
+    if [[ "$1" =~ -h|--help|--usage ]]; then
+        sed -n '3,/^$/s/^#//p' "$0"
+        exit 0
+    fi
+
+    mkdir -p "$BENCHDIR/tmp"
+    $CC -o "$BENCHDIR/tmp/packcc_reuse" "$ROOTDIR/src/packcc.c"
+    "$BENCHDIR/tmp/packcc_reuse" -o "$BENCHDIR/tmp/parser_reuse" "$BENCHDIR/reuse/reuse.peg"
+    $CC -I"$BENCHDIR/tmp" "$BENCHDIR/tmp/parser_reuse.c" -o "$BENCHDIR/tmp/parser_reuse"
+    "$BENCHDIR/tmp/parser_reuse" "$INPUT" "$ROUNDS"
+}
+
+main "$@"
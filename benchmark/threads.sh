@@ -0,0 +1,38 @@
+#!/usr/bin/env bash
+#
+# Generates, builds and runs a parser which parses each line of the input as a separate document
+# in several threads at once, each thread using its own context, and prints the throughput for
+# 1, 2, 4, ... threads up to the given number, to show how the parsing scales with the threads.
+#
+# Usage:
+#   ./threads.sh [input] [rounds] [threads]
+#
+# Environment:
+#   CC              Compiler to use, default: "cc -O2"
+#
+# Example:
+#   CC="clang -O3" ./threads.sh inputs/calc.txt 100 16
+
+main() {
+    set -e
+
+    BENCHDIR="$(cd "$(dirname "$0")" && pwd)"
+    ROOTDIR="$BENCHDIR/.."
+    CC="${CC:-cc -O2}"
+    INPUT="${1:-$BENCHDIR/inputs/calc.txt}"
+    ROUNDS="${2:-100}"
+    THREADS="${3:-8}"
+
+    if [[ "$1" =~ -h|--help|--usage ]]; then
+        sed -n '3,/^$/s/^#//p' "$0"
+        exit 0
+    fi
+
+    mkdir -p "$BENCHDIR/tmp"
+    $CC -o "$BENCHDIR/tmp/packcc_threads" "$ROOTDIR/src/packcc.c"
+    "$BENCHDIR/tmp/packcc_threads" -o "$BENCHDIR/tmp/parser_threads" "$BENCHDIR/threads/threads.peg"
+    $CC -pthread -I"$BENCHDIR/tmp" "$BENCHDIR/tmp/parser_threads.c" -o "$BENCHDIR/tmp/parser_threads"
+    "$BENCHDIR/tmp/parser_threads" "$INPUT" "$ROUNDS" "$THREADS"
+}
+
+main "$@"
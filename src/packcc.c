@@ -44,6 +44,12 @@
 #include <limits.h>
 #include <assert.h>
 
+#ifdef PCC_LIBRARY
+#include <setjmp.h>
+
+#include "packcc.h"
+#endif
+
 #ifndef _MSC_VER
 #if defined __GNUC__ && defined _WIN32 /* MinGW */
 #ifndef PCC_USE_SYSTEM_STRNLEN
@@ -80,6 +86,18 @@ static size_t strnlen_(const char *str, size_t maxlen) {
 #ifndef ARRAY_MIN_SIZE
 #define ARRAY_MIN_SIZE 2
 #endif
+#ifndef INLINE_MAX_NODES
+#define INLINE_MAX_NODES 16 /* the maximum weight of the nodes of a rule to be inlined automatically */
+#endif
+#ifndef INLINE_MAX_CHARCLASS_ITEMS
+#define INLINE_MAX_CHARCLASS_ITEMS 8 /* the maximum number of items of a character class in a rule to be inlined automatically */
+#endif
+#ifndef INLINE_MAX_GROWTH
+#define INLINE_MAX_GROWTH 64 /* the maximum weight by which a rule can grow with the rules inlined automatically */
+#endif
+#ifndef SPLIT_MAX
+#define SPLIT_MAX 1000 /* the maximum number of the source files for the rules */
+#endif
 
 #define VOID_VALUE (~(size_t)0)
 
@@ -99,18 +117,18 @@ typedef enum bool_tag {
     TRUE
 } bool_t;
 
-typedef struct stream_tag {
-    FILE *file;       /* the stream; just a reference */
-    const char *name; /* the file name */
-    size_t line;      /* the current line number (0-based); line counting is disabled if VOID_VALUE */
-} stream_t;
-
 typedef struct char_array_tag {
     char *buf;
     size_t max;
     size_t len;
 } char_array_t;
 
+typedef struct stream_tag {
+    char_array_t text; /* the text written; saved to the file at last */
+    const char *name;  /* the file name */
+    size_t line;       /* the current line number (0-based); line counting is disabled if VOID_VALUE */
+} stream_t;
+
 typedef struct code_block_tag {
     char *text;
     size_t len;
@@ -139,6 +157,15 @@ typedef enum node_type_tag {
     NODE_ERROR
 } node_type_t;
 
+typedef enum rule_attr_tag {
+    RULE_ATTR__NONE = 0,
+    RULE_ATTR__SKIP = 1,
+    RULE_ATTR__INLINE = 2,
+    RULE_ATTR__THUNKLESS = 4, /* never produces thunks */
+    RULE_ATTR__EAGER = 8,
+    RULE_ATTR__AUTO_INLINE = 16 /* inlined without %inline */
+} rule_attr_t;
+
 typedef struct node_tag node_t;
 
 typedef struct node_array_tag {
@@ -163,6 +190,9 @@ typedef struct node_rule_tag {
     char *name;
     node_t *expr;
     int ref; /* mutable */
+    rule_attr_t attrs; /* mutable */
+    size_t layout; /* mutable; the index of the thunk chunk layout */
+    size_t part; /* mutable; the index of the source file containing the rule functions if split */
     node_const_array_t vars;
     node_const_array_t capts;
     node_const_array_t codes;
@@ -256,18 +286,35 @@ typedef struct options_tag {
     bool_t ascii; /* UTF-8 support is disabled if true  */
     bool_t lines; /* #line directives are output if true */
     bool_t debug; /* debug information is output if true */
+    int level;    /* the optimization level */
+    size_t split; /* the number of the source files for the rules (0 means not split) */
+    const char *runtime; /* the base name of the shared runtime files (NULL means the runtime is embedded) */
 } options_t;
 
 typedef enum code_flag_tag {
     CODE_FLAG__NONE = 0,
-    CODE_FLAG__UTF8_CHARCLASS_USED = 1
+    CODE_FLAG__UTF8_CHARCLASS_USED = 1,
+    CODE_FLAG__EVENT = 2, /* %event is specified */
+    CODE_FLAG__AST = 4, /* %ast is specified */
+    CODE_FLAG__INTERN = 8, /* %intern is specified */
+    CODE_FLAG__ARENA = 16, /* %arena is specified */
+    CODE_FLAG__STATS = 32 /* %stats is specified */
 } code_flag_t;
 
+typedef struct output_set_tag {
+    stream_t *streams; /* the streams of the C source file, the C header file, the private header, the split source files, and the shared runtime files, in this order */
+    char **names;      /* the path names of the files owned by this set, parallel to the streams (NULL if owned by the context) */
+    char *pid;         /* the macro name for the include guard of the private header */
+    size_t len;        /* the number of the streams */
+} output_set_t;
+
 typedef struct context_tag {
     char *iname;  /* the path name of the PEG file being parsed */
     char *sname;  /* the path name of the C source file being generated */
     char *hname;  /* the path name of the C header file being generated */
-    FILE *ifile;  /* the input stream of the PEG file */
+    FILE *ifile;  /* the input stream of the PEG file (NULL if the PEG text is given in memory) */
+    const char *itext; /* the rest of the PEG text given in memory */
+    size_t ilen;  /* the length of the rest of the PEG text given in memory */
     char *hid;    /* the macro name for the include guard of the C header file */
     char *vtype;  /* the type name of the data output by the parsing API function (NULL means the default) */
     char *atype;  /* the type name of the user-defined data passed to the parser creation API function (NULL means the default) */
@@ -283,10 +330,14 @@ typedef struct context_tag {
     char_array_t buffer; /* the character buffer */
     node_array_t rules;  /* the PEG rules */
     node_hash_table_t rulehash; /* the hash table to accelerate access of desired PEG rules */
+    node_array_t skips;  /* the references to the rules from %skip directives */
+    node_array_t inlines; /* the references to the rules from %inline directives */
+    node_array_t eagers; /* the references to the rules from %eager directives */
     code_block_array_t esource; /* the code blocks from %earlysource and %earlycommon directives to be added into the generated source file */
     code_block_array_t eheader; /* the code blocks from %earlyheader and %earlycommon directives to be added into the generated header file */
     code_block_array_t source;  /* the code blocks from %source and %common directives to be added into the generated source file */
     code_block_array_t header;  /* the code blocks from %header and %common directives to be added into the generated header file */
+    output_set_t outputs; /* the files being generated; released with the context even if the generation is interrupted */
 } context_t;
 
 typedef struct generate_tag {
@@ -294,8 +345,18 @@ typedef struct generate_tag {
     const node_t *rule;
     int label;
     bool_t ascii;
+    bool_t chunk; /* FALSE if the function being generated has no thunk chunk */
+    bool_t event; /* TRUE if the events are delivered */
 } generate_t;
 
+typedef node_t *(*node_rewriter_t)(context_t *ctx, node_t *rule, node_t *node, bool_t *changed);
+
+typedef struct optimizer_pass_tag {
+    const char *name;     /* the pass name reported with debug information */
+    int level;            /* the minimum optimization level to enable the pass */
+    node_rewriter_t func; /* the function to rewrite a node whose child nodes are already rewritten */
+} optimizer_pass_t;
+
 typedef enum string_flag_tag {
     STRING_FLAG__NONE = 0,
     STRING_FLAG__NOTEMPTY = 1,
@@ -311,10 +372,53 @@ typedef enum code_reach_tag {
 
 static const char *g_cmdname = "packcc"; /* replaced later with actual one */
 
+#ifdef PCC_LIBRARY
+static const packcc_sink_t *g_sink = NULL; /* the sink of the library call in progress (NULL if none) */
+static const char *g_iname = NULL; /* the name of the PEG text being parsed in the library call */
+static jmp_buf *g_exit = NULL; /* the point to return to instead of exiting the process */
+
+static void report_error(char *message) { /* splits the location off the message */
+    packcc_diagnostic_t d;
+    const size_t l = (g_iname != NULL) ? strlen(g_iname) : 0;
+    const size_t n = strlen(message);
+    char *e = NULL;
+    if (n > 0 && message[n - 1] == '\n') message[n - 1] = '\0';
+    d.name = NULL;
+    d.line = 0;
+    d.col = 0;
+    d.message = message;
+    if (l > 0 && strncmp(message, g_iname, l) == 0 && message[l] == ':') {
+        const unsigned long line = strtoul(message + l + 1, &e, 10);
+        if (e != message + l + 1 && *e == ':') {
+            const char *const p = e + 1;
+            const unsigned long col = strtoul(p, &e, 10);
+            if (e != p && e[0] == ':' && e[1] == ' ') {
+                d.name = g_iname;
+                d.line = (size_t)line;
+                d.col = (size_t)col;
+                d.message = e + 2;
+            }
+        }
+    }
+    g_sink->report(g_sink->data, &d);
+}
+#endif
+
 __attribute__((format(printf, 1, 2)))
 static int print_error(const char *format, ...) {
     int n;
     va_list a;
+#ifdef PCC_LIBRARY
+    if (g_sink != NULL && g_sink->report != NULL) {
+        char s[1024];
+        va_start(a, format);
+        n = vsnprintf(s, sizeof(s), format, a);
+        va_end(a);
+        s[sizeof(s) - 1] = '\0'; /* truncates an overlong message */
+        report_error(s);
+        return n;
+    }
+#endif
     va_start(a, format);
     n = fprintf(stderr, "%s: ", g_cmdname);
     if (n >= 0) {
@@ -325,11 +429,19 @@ static int print_error(const char *format, ...) {
     return n;
 }
 
+__attribute__((noreturn))
+static void exit_e(int status) {
+#ifdef PCC_LIBRARY
+    if (g_exit != NULL) longjmp(*g_exit, status);
+#endif
+    exit(status);
+}
+
 static FILE *fopen_rb_e(const char *path) {
     FILE *const f = fopen(path, "rb");
     if (f == NULL) {
         print_error("Cannot open file '%s' to read\n", path);
-        exit(2);
+        exit_e(2);
     }
     return f;
 }
@@ -338,7 +450,7 @@ static FILE *fopen_wt_e(const char *path) {
     FILE *const f = fopen(path, "wt");
     if (f == NULL) {
         print_error("Cannot open file '%s' to write\n", path);
-        exit(2);
+        exit_e(2);
     }
     return f;
 }
@@ -347,7 +459,7 @@ static int fclose_e(FILE *stream) {
     const int r = fclose(stream);
     if (r == EOF) {
         print_error("File closing error\n");
-        exit(2);
+        exit_e(2);
     }
     return r;
 }
@@ -356,7 +468,7 @@ static int fgetc_e(FILE *stream) {
     const int c = fgetc(stream);
     if (c == EOF && ferror(stream)) {
         print_error("File read error\n");
-        exit(2);
+        exit_e(2);
     }
     return c;
 }
@@ -365,7 +477,7 @@ static void *malloc_e(size_t size) {
     void *const p = malloc(size);
     if (p == NULL) {
         print_error("Out of memory\n");
-        exit(3);
+        exit_e(3);
     }
     return p;
 }
@@ -374,7 +486,7 @@ static void *realloc_e(void *ptr, size_t size) {
     void *const p = realloc(ptr, size);
     if (p == NULL) {
         print_error("Out of memory\n");
-        exit(3);
+        exit_e(3);
     }
     return p;
 }
@@ -494,6 +606,14 @@ static bool_t is_pointer_type(const char *str) {
     return (n > 0 && str[n - 1] == '*') ? TRUE : FALSE;
 }
 
+static bool_t is_ascii_string(const char *str) {
+    size_t i;
+    for (i = 0; str[i]; i++) {
+        if ((unsigned char)str[i] >= 0x80) return FALSE;
+    }
+    return TRUE;
+}
+
 static bool_t is_valid_utf8_string(const char *str) {
     int k = 0, n = 0, u = 0;
     size_t i;
@@ -820,89 +940,128 @@ static void make_header_identifier(char *str) {
     }
 }
 
-static stream_t stream__wrap(FILE *file, const char *name, size_t line) {
-    stream_t s;
-    s.file = file;
-    s.name = name;
-    s.line = line;
-    return s;
+static void char_array__init(char_array_t *array) {
+    array->len = 0;
+    array->max = 0;
+    array->buf = NULL;
 }
 
-static int stream__putc(stream_t *stream, int c) {
-    const int r = fputc(c, stream->file);
-    if (r == EOF) {
-        print_error("File write error\n");
-        exit(2);
+static void char_array__add(char_array_t *array, char ch) {
+    if (array->max <= array->len) {
+        const size_t n = array->len + 1;
+        size_t m = array->max;
+        if (m == 0) m = BUFFER_MIN_SIZE;
+        while (m < n && m != 0) m <<= 1;
+        if (m == 0) m = n; /* in case of shift overflow */
+        array->buf = (char *)realloc_e(array->buf, m);
+        array->max = m;
     }
+    array->buf[array->len++] = ch;
+}
+
+static void char_array__term(char_array_t *array) {
+    free(array->buf);
+}
+
+static void stream__init(stream_t *stream, const char *name, size_t line) {
+    char_array__init(&stream->text);
+    stream->name = name;
+    stream->line = line;
+}
+
+static int stream__putc(stream_t *stream, int c) {
+    char_array__add(&stream->text, (char)c);
     if (stream->line != VOID_VALUE) {
         if (c == '\n') stream->line++;
     }
-    return r;
+    return c;
 }
 
 static int stream__puts(stream_t *stream, const char *s) {
-    const int r = fputs(s, stream->file);
-    if (r == EOF) {
-        print_error("File write error\n");
-        exit(2);
-    }
-    if (stream->line != VOID_VALUE) {
-        size_t i = 0;
-        for (i = 0; s[i]; i++) {
-            if (s[i] == '\n') stream->line++;
-        }
+    size_t i;
+    for (i = 0; s[i]; i++) {
+        stream__putc(stream, (int)(unsigned char)s[i]);
     }
-    return r;
+    return (int)i;
 }
 
 __attribute__((format(printf, 2, 3)))
 static int stream__printf(stream_t *stream, const char *format, ...) {
-    if (stream->line != VOID_VALUE) {
 #define M 1024
-        char s[M], *p = NULL;
-        int n = 0;
-        size_t l = 0;
-        {
-            va_list a;
-            va_start(a, format);
-            n = vsnprintf(NULL, 0, format, a);
-            va_end(a);
-            if (n < 0) {
-                print_error("Internal error\n");
-                exit(2);
-            }
-            l = (size_t)n + 1;
-        }
-        p = (l > M) ? (char *)malloc_e(l) : s;
-        {
-            va_list a;
-            va_start(a, format);
-            n = vsnprintf(p, l, format, a);
-            va_end(a);
-            if (n < 0 || (size_t)n >= l) {
-                print_error("Internal error\n");
-                exit(2);
-            }
+    char s[M], *p = NULL;
+    int n = 0;
+    size_t l = 0;
+    {
+        va_list a;
+        va_start(a, format);
+        n = vsnprintf(NULL, 0, format, a);
+        va_end(a);
+        if (n < 0) {
+            print_error("Internal error\n");
+            exit_e(2);
         }
-        stream__puts(stream, p);
-        if (p != s) free(p);
-        return n;
-#undef M
+        l = (size_t)n + 1;
     }
-    else {
-        int n;
+    p = (l > M) ? (char *)malloc_e(l) : s;
+    {
         va_list a;
         va_start(a, format);
-        n = vfprintf(stream->file, format, a);
+        n = vsnprintf(p, l, format, a);
         va_end(a);
-        if (n < 0) {
-            print_error("File write error\n");
-            exit(2);
+        if (n < 0 || (size_t)n >= l) {
+            print_error("Internal error\n");
+            exit_e(2);
+        }
+    }
+    stream__puts(stream, p);
+    if (p != s) free(p);
+    return n;
+#undef M
+}
+
+static bool_t stream__is_saved(const stream_t *stream) { /* checks if the file has the same text already */
+    const char *const p = stream->text.buf;
+    const size_t n = stream->text.len;
+    size_t i = 0;
+    int c;
+    FILE *const f = fopen(stream->name, "rt");
+    if (f == NULL) return FALSE;
+    while ((c = fgetc(f)) != EOF) {
+        if (i >= n || c != (int)(unsigned char)p[i]) break;
+        i++;
+    }
+    fclose(f);
+    return (c == EOF && i == n) ? TRUE : FALSE;
+}
+
+static void stream__save(stream_t *stream) { /* leaves the file untouched if unchanged so as not to trigger rebuilding */
+    FILE *f;
+    if (stream__is_saved(stream)) return;
+    f = fopen_wt_e(stream->name);
+    if (stream->text.len > 0 && fwrite(stream->text.buf, 1, stream->text.len, f) != stream->text.len) {
+        print_error("File write error\n");
+        exit_e(2);
+    }
+    fclose_e(f);
+}
+
+static void stream__insert(stream_t *stream, size_t pos, const stream_t *text) { /* no #line directive must follow the position */
+    const size_t l = stream->text.len;
+    size_t i;
+    for (i = 0; i < text->text.len; i++) char_array__add(&stream->text, '\0');
+    memmove(stream->text.buf + pos + text->text.len, stream->text.buf + pos, l - pos);
+    if (text->text.len > 0) memcpy(stream->text.buf + pos, text->text.buf, text->text.len);
+    if (stream->line != VOID_VALUE) {
+        for (i = 0; i < text->text.len; i++) {
+            if (text->text.buf[i] == '\n') stream->line++;
         }
-        return n;
     }
 }
 
+static void stream__term(stream_t *stream) {
+    char_array__term(&stream->text);
+}
+
 static void stream__write_characters(stream_t *stream, char ch, size_t len) {
     size_t i;
     if (len == VOID_VALUE) return; /* for safety */
@@ -1075,29 +1234,6 @@ static size_t column_number(const context_t *ctx) { /* 0-based */
         return ctx->charnum + count_characters(ctx->buffer.buf, (ctx->linepos > ctx->bufpos) ? ctx->linepos - ctx->bufpos : 0, ctx->bufcur);
 }
 
-static void char_array__init(char_array_t *array) {
-    array->len = 0;
-    array->max = 0;
-    array->buf = NULL;
-}
-
-static void char_array__add(char_array_t *array, char ch) {
-    if (array->max <= array->len) {
-        const size_t n = array->len + 1;
-        size_t m = array->max;
-        if (m == 0) m = BUFFER_MIN_SIZE;
-        while (m < n && m != 0) m <<= 1;
-        if (m == 0) m = n; /* in case of shift overflow */
-        array->buf = (char *)realloc_e(array->buf, m);
-        array->max = m;
-    }
-    array->buf[array->len++] = ch;
-}
-
-static void char_array__term(char_array_t *array) {
-    free(array->buf);
-}
-
 static void code_block__init(code_block_t *code) {
     code->text = NULL;
     code->len = 0;
@@ -1201,12 +1337,29 @@ static void node_const_array__term(node_const_array_t *array) {
     free((node_t **)array->buf);
 }
 
-static context_t *create_context(const char *iname, const char *oname, const options_t *opts) {
+static void release_outputs(output_set_t *outputs) {
+    size_t i;
+    for (i = 0; i < outputs->len; i++) {
+        stream__term(&outputs->streams[i]);
+        free(outputs->names[i]);
+    }
+    free(outputs->streams);
+    free(outputs->names);
+    free(outputs->pid);
+    outputs->streams = NULL;
+    outputs->names = NULL;
+    outputs->pid = NULL;
+    outputs->len = 0;
+}
+
+static context_t *create_context(const char *iname, const char *itext, size_t ilen, const char *oname, const options_t *opts) {
     context_t *const ctx = (context_t *)malloc_e(sizeof(context_t));
     ctx->iname = strdup_e((iname && iname[0]) ? iname : "-");
     ctx->sname = (oname && oname[0]) ? add_fileext(oname, "c") : replace_fileext(ctx->iname, "c");
     ctx->hname = (oname && oname[0]) ? add_fileext(oname, "h") : replace_fileext(ctx->iname, "h");
-    ctx->ifile = (iname && iname[0]) ? fopen_rb_e(ctx->iname) : stdin;
+    ctx->ifile = (itext != NULL) ? NULL : (iname && iname[0]) ? fopen_rb_e(ctx->iname) : stdin;
+    ctx->itext = itext;
+    ctx->ilen = (itext != NULL) ? ilen : 0;
     ctx->hid = strdup_e(ctx->hname); make_header_identifier(ctx->hid);
     ctx->vtype = NULL;
     ctx->atype = NULL;
@@ -1224,10 +1377,17 @@ static context_t *create_context(const char *iname, const char *oname, const opt
     ctx->rulehash.mod = 0;
     ctx->rulehash.max = 0;
     ctx->rulehash.buf = NULL;
+    node_array__init(&ctx->skips);
+    node_array__init(&ctx->inlines);
+    node_array__init(&ctx->eagers);
     code_block_array__init(&ctx->esource);
     code_block_array__init(&ctx->eheader);
     code_block_array__init(&ctx->source);
     code_block_array__init(&ctx->header);
+    ctx->outputs.streams = NULL;
+    ctx->outputs.names = NULL;
+    ctx->outputs.pid = NULL;
+    ctx->outputs.len = 0;
     return ctx;
 }
 
@@ -1239,6 +1399,9 @@ static node_t *create_node(node_type_t type) {
         node->data.rule.name = NULL;
         node->data.rule.expr = NULL;
         node->data.rule.ref = 0;
+        node->data.rule.attrs = RULE_ATTR__NONE;
+        node->data.rule.layout = 0;
+        node->data.rule.part = 0;
         node_const_array__init(&node->data.rule.vars);
         node_const_array__init(&node->data.rule.capts);
         node_const_array__init(&node->data.rule.codes);
@@ -1297,7 +1460,7 @@ static node_t *create_node(node_type_t type) {
         break;
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
     return node;
 }
@@ -1352,17 +1515,21 @@ static void destroy_node(node_t *node) {
         break;
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
     free(node);
 }
 
 static void destroy_context(context_t *ctx) {
     if (ctx == NULL) return;
+    release_outputs(&ctx->outputs);
     code_block_array__term(&ctx->header);
     code_block_array__term(&ctx->source);
     code_block_array__term(&ctx->eheader);
     code_block_array__term(&ctx->esource);
+    node_array__term(&ctx->eagers);
+    node_array__term(&ctx->inlines);
+    node_array__term(&ctx->skips);
     free((node_t **)ctx->rulehash.buf);
     node_array__term(&ctx->rules);
     char_array__term(&ctx->buffer);
@@ -1370,7 +1537,7 @@ static void destroy_context(context_t *ctx) {
     free(ctx->atype);
     free(ctx->vtype);
     free(ctx->hid);
-    fclose_e(ctx->ifile);
+    if (ctx->ifile != NULL) fclose_e(ctx->ifile);
     free(ctx->hname);
     free(ctx->sname);
     free(ctx->iname);
@@ -1416,7 +1583,7 @@ static void link_references(context_t *ctx, node_t *node) {
     switch (node->type) {
     case NODE_RULE:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     case NODE_REFERENCE:
         node->data.reference.rule = lookup_rulehash(ctx, node->data.reference.name);
         if (node->data.reference.rule == NULL) {
@@ -1468,7 +1635,7 @@ static void link_references(context_t *ctx, node_t *node) {
         break;
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
 }
 
@@ -1483,7 +1650,7 @@ static void verify_variables(context_t *ctx, node_t *node, node_const_array_t *v
     switch (node->type) {
     case NODE_RULE:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     case NODE_REFERENCE:
         if (node->data.reference.index != VOID_VALUE) {
             size_t i;
@@ -1545,7 +1712,7 @@ static void verify_variables(context_t *ctx, node_t *node, node_const_array_t *v
         break;
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
     if (b) {
         node_const_array__term(&a);
@@ -1563,7 +1730,7 @@ static void verify_captures(context_t *ctx, node_t *node, node_const_array_t *ca
     switch (node->type) {
     case NODE_RULE:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     case NODE_REFERENCE:
         break;
     case NODE_STRING:
@@ -1627,168 +1794,1541 @@ static void verify_captures(context_t *ctx, node_t *node, node_const_array_t *ca
         break;
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
     if (b) {
         node_const_array__term(&a);
     }
 }
 
-static void dump_escaped_string(const char *str) {
-    char s[5];
-    if (str == NULL) {
-        fprintf(stdout, "null");
-        return;
-    }
-    while (*str) {
-        fprintf(stdout, "%s", escape_character(*str++, &s));
-    }
-}
-
-static void dump_integer_value(size_t value) {
-    if (value == VOID_VALUE) {
-        fprintf(stdout, "void");
-    }
-    else {
-        fprintf(stdout, FMT_LU, (ulong_t)value);
-    }
-}
-
-static void dump_node(context_t *ctx, const node_t *node, const int indent) {
+static void verify_skipper(context_t *ctx, node_t *node, node_const_array_t *rules) { /* rules: the rules being verified */
     if (node == NULL) return;
     switch (node->type) {
     case NODE_RULE:
-        fprintf(stdout, "%*sRule(name:'%s', ref:%d, vars.len:" FMT_LU ", capts.len:" FMT_LU ", codes.len:" FMT_LU ") {\n",
-            indent, "", node->data.rule.name, node->data.rule.ref,
-            (ulong_t)node->data.rule.vars.len, (ulong_t)node->data.rule.capts.len, (ulong_t)node->data.rule.codes.len);
-        dump_node(ctx, node->data.rule.expr, indent + 2);
-        fprintf(stdout, "%*s}\n", indent, "");
+        {
+            size_t i;
+            for (i = 0; i < rules->len; i++) {
+                if (rules->buf[i] == node) break;
+            }
+            if (i < rules->len) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Recursive rule '%s' not allowed for %%skip\n",
+                    ctx->iname, (ulong_t)(node->data.rule.line + 1), (ulong_t)(node->data.rule.col + 1), node->data.rule.name);
+                ctx->errnum++;
+                break;
+            }
+            if (node->data.rule.attrs & RULE_ATTR__SKIP) break; /* already verified */
+            if (node->data.rule.vars.len > 0 || node->data.rule.capts.len > 0 || node->data.rule.codes.len > 0) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Action, capture, or variable not allowed in rule '%s' for %%skip\n",
+                    ctx->iname, (ulong_t)(node->data.rule.line + 1), (ulong_t)(node->data.rule.col + 1), node->data.rule.name);
+                ctx->errnum++;
+            }
+            node_const_array__add(rules, node);
+            verify_skipper(ctx, node->data.rule.expr, rules);
+            rules->len--;
+            node->data.rule.attrs |= RULE_ATTR__SKIP;
+        }
         break;
     case NODE_REFERENCE:
-        fprintf(stdout, "%*sReference(var:'%s', index:", indent, "", node->data.reference.var);
-        dump_integer_value(node->data.reference.index);
-        fprintf(stdout, ", name:'%s', rule:'%s')\n", node->data.reference.name,
-            (node->data.reference.rule) ? node->data.reference.rule->data.rule.name : NULL);
+        verify_skipper(ctx, (node_t *)node->data.reference.rule, rules);
         break;
     case NODE_STRING:
-        fprintf(stdout, "%*sString(value:'", indent, "");
-        dump_escaped_string(node->data.string.value);
-        fprintf(stdout, "')\n");
         break;
     case NODE_CHARCLASS:
-        fprintf(stdout, "%*sCharclass(value:'", indent, "");
-        dump_escaped_string(node->data.charclass.value);
-        fprintf(stdout, "')\n");
         break;
     case NODE_QUANTITY:
-        fprintf(stdout, "%*sQuantity(min:%d, max:%d) {\n", indent, "", node->data.quantity.min, node->data.quantity.max);
-        dump_node(ctx, node->data.quantity.expr, indent + 2);
-        fprintf(stdout, "%*s}\n", indent, "");
+        verify_skipper(ctx, node->data.quantity.expr, rules);
         break;
     case NODE_PREDICATE:
-        fprintf(stdout, "%*sPredicate(neg:%d) {\n", indent, "", node->data.predicate.neg);
-        dump_node(ctx, node->data.predicate.expr, indent + 2);
-        fprintf(stdout, "%*s}\n", indent, "");
+        verify_skipper(ctx, node->data.predicate.expr, rules);
         break;
     case NODE_SEQUENCE:
-        fprintf(stdout, "%*sSequence(max:" FMT_LU ", len:" FMT_LU ") {\n",
-            indent, "", (ulong_t)node->data.sequence.nodes.max, (ulong_t)node->data.sequence.nodes.len);
         {
             size_t i;
             for (i = 0; i < node->data.sequence.nodes.len; i++) {
-                dump_node(ctx, node->data.sequence.nodes.buf[i], indent + 2);
+                verify_skipper(ctx, node->data.sequence.nodes.buf[i], rules);
             }
         }
-        fprintf(stdout, "%*s}\n", indent, "");
         break;
     case NODE_ALTERNATE:
-        fprintf(stdout, "%*sAlternate(max:" FMT_LU ", len:" FMT_LU ") {\n",
-            indent, "", (ulong_t)node->data.alternate.nodes.max, (ulong_t)node->data.alternate.nodes.len);
         {
             size_t i;
             for (i = 0; i < node->data.alternate.nodes.len; i++) {
-                dump_node(ctx, node->data.alternate.nodes.buf[i], indent + 2);
+                verify_skipper(ctx, node->data.alternate.nodes.buf[i], rules);
             }
         }
-        fprintf(stdout, "%*s}\n", indent, "");
         break;
     case NODE_CAPTURE:
-        fprintf(stdout, "%*sCapture(index:", indent, "");
-        dump_integer_value(node->data.capture.index);
-        fprintf(stdout, ") {\n");
-        dump_node(ctx, node->data.capture.expr, indent + 2);
-        fprintf(stdout, "%*s}\n", indent, "");
         break;
     case NODE_EXPAND:
-        fprintf(stdout, "%*sExpand(index:", indent, "");
-        dump_integer_value(node->data.expand.index);
-        fprintf(stdout, ")\n");
         break;
     case NODE_ACTION:
-        fprintf(stdout, "%*sAction(index:", indent, "");
-        dump_integer_value(node->data.action.index);
-        fprintf(stdout, ", code:{");
-        dump_escaped_string(node->data.action.code.text);
-        fprintf(stdout, "}, vars:");
-        if (node->data.action.vars.len + node->data.action.capts.len > 0) {
-            size_t i;
-            fprintf(stdout, "\n");
-            for (i = 0; i < node->data.action.vars.len; i++) {
-                fprintf(stdout, "%*s'%s'\n", indent + 2, "", node->data.action.vars.buf[i]->data.reference.var);
-            }
-            for (i = 0; i < node->data.action.capts.len; i++) {
-                fprintf(stdout, "%*s$" FMT_LU "\n", indent + 2, "", (ulong_t)(node->data.action.capts.buf[i]->data.capture.index + 1));
-            }
-            fprintf(stdout, "%*s)\n", indent, "");
-        }
-        else {
-            fprintf(stdout, "none)\n");
-        }
         break;
     case NODE_ERROR:
-        fprintf(stdout, "%*sError(index:", indent, "");
-        dump_integer_value(node->data.error.index);
-        fprintf(stdout, ", code:{");
-        dump_escaped_string(node->data.error.code.text);
-        fprintf(stdout, "}, vars:\n");
-        {
-            size_t i;
-            for (i = 0; i < node->data.error.vars.len; i++) {
-                fprintf(stdout, "%*s'%s'\n", indent + 2, "", node->data.error.vars.buf[i]->data.reference.var);
-            }
-            for (i = 0; i < node->data.error.capts.len; i++) {
-                fprintf(stdout, "%*s$" FMT_LU "\n", indent + 2, "", (ulong_t)(node->data.error.capts.buf[i]->data.capture.index + 1));
-            }
-        }
-        fprintf(stdout, "%*s) {\n", indent, "");
-        dump_node(ctx, node->data.error.expr, indent + 2);
-        fprintf(stdout, "%*s}\n", indent, "");
         break;
     default:
-        print_error("%*sInternal error [%d]\n", indent, "", __LINE__);
-        exit(-1);
-    }
-}
-
-static size_t refill_buffer(context_t *ctx, size_t num) {
-    if (ctx->buffer.len >= ctx->bufcur + num) return ctx->buffer.len - ctx->bufcur;
-    while (ctx->buffer.len < ctx->bufcur + num) {
-        const int c = fgetc_e(ctx->ifile);
-        if (c == EOF) break;
-        char_array__add(&ctx->buffer, (char)c);
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
     }
-    return ctx->buffer.len - ctx->bufcur;
 }
 
-static void commit_buffer(context_t *ctx) {
-    assert(ctx->buffer.len >= ctx->bufcur);
-    if (ctx->linepos < ctx->bufpos + ctx->bufcur)
-        ctx->charnum += ctx->opts.ascii ? ctx->bufcur : count_characters(ctx->buffer.buf, 0, ctx->bufcur);
-    memmove(ctx->buffer.buf, ctx->buffer.buf + ctx->bufcur, ctx->buffer.len - ctx->bufcur);
-    ctx->buffer.len -= ctx->bufcur;
-    ctx->bufpos += ctx->bufcur;
-    ctx->bufcur = 0;
-}
+static bool_t is_always_succeeding(const node_t *node) { /* conservative; rule references are not followed */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        return is_always_succeeding(node->data.rule.expr);
+    case NODE_REFERENCE:
+        return FALSE;
+    case NODE_STRING:
+        return (node->data.string.value == NULL || node->data.string.value[0] == '\0') ? TRUE : FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return (node->data.quantity.min <= 0) ? TRUE : is_always_succeeding(node->data.quantity.expr);
+    case NODE_PREDICATE:
+        return node->data.predicate.neg ? FALSE : is_always_succeeding(node->data.predicate.expr);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (!is_always_succeeding(node->data.sequence.nodes.buf[i])) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_always_succeeding(node->data.alternate.nodes.buf[i])) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_always_succeeding(node->data.capture.expr);
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return TRUE;
+    case NODE_ERROR:
+        return is_always_succeeding(node->data.error.expr);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t gather_first_bytes(const node_t *node, bool_t ascii, bool_t *bytes) { /* the rules referenced must not be recursive */
+    /* marks in bytes[256] every byte that can be consumed first; returns TRUE if the node can succeed without consuming any byte */
+    if (node == NULL) return TRUE;
+    switch (node->type) {
+    case NODE_RULE:
+        return gather_first_bytes(node->data.rule.expr, ascii, bytes);
+    case NODE_REFERENCE:
+        return gather_first_bytes(node->data.reference.rule, ascii, bytes);
+    case NODE_STRING:
+        if (node->data.string.value == NULL || node->data.string.value[0] == '\0') return TRUE;
+        bytes[(unsigned char)node->data.string.value[0]] = TRUE;
+        return FALSE;
+    case NODE_CHARCLASS:
+        {
+            const char *const value = node->data.charclass.value;
+            const size_t n = (value != NULL) ? strlen(value) : 0;
+            size_t i;
+            if (value == NULL || value[0] == '^') {
+                for (i = 0; i < 256; i++) bytes[i] = TRUE;
+                return FALSE;
+            }
+            for (i = 0; i < n; i++) {
+                int u0, u1;
+                if (value[i] == '\\' && i + 1 < n) i++;
+                if (ascii) {
+                    u0 = (int)(unsigned char)value[i];
+                    if (i + 2 < n && value[i + 1] == '-') {
+                        u1 = (int)(unsigned char)value[i + 2];
+                        i += 2;
+                    }
+                    else {
+                        u1 = u0;
+                    }
+                }
+                else {
+                    i += utf8_to_utf32(value + i, &u0) - 1;
+                    if (i + 2 < n && value[i + 1] == '-') {
+                        i += 2;
+                        if (value[i] == '\\' && i + 1 < n) i++;
+                        i += utf8_to_utf32(value + i, &u1) - 1;
+                    }
+                    else {
+                        u1 = u0;
+                    }
+                    if (u1 >= 0x80) { /* any lead byte of multibyte characters */
+                        int c;
+                        for (c = 0x80; c < 256; c++) bytes[c] = TRUE;
+                        if (u1 > 0x7f) u1 = 0x7f;
+                    }
+                }
+                for (; u0 <= u1; u0++) bytes[u0] = TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_QUANTITY:
+        return (gather_first_bytes(node->data.quantity.expr, ascii, bytes) || node->data.quantity.min <= 0) ? TRUE : FALSE;
+    case NODE_PREDICATE:
+        return TRUE;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (!gather_first_bytes(node->data.sequence.nodes.buf[i], ascii, bytes)) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_ALTERNATE:
+        {
+            bool_t b = FALSE;
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (gather_first_bytes(node->data.alternate.nodes.buf[i], ascii, bytes)) b = TRUE;
+            }
+            return b;
+        }
+    case NODE_CAPTURE:
+        return gather_first_bytes(node->data.capture.expr, ascii, bytes);
+    case NODE_EXPAND:
+        {
+            size_t i;
+            for (i = 0; i < 256; i++) bytes[i] = TRUE;
+        }
+        return TRUE;
+    case NODE_ACTION:
+        return TRUE;
+    case NODE_ERROR:
+        return gather_first_bytes(node->data.error.expr, ascii, bytes);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_pure_rule(const node_t *rule) {
+    return (rule->data.rule.vars.len == 0 && rule->data.rule.capts.len == 0 && rule->data.rule.codes.len == 0) ? TRUE : FALSE;
+}
+
+static bool_t is_text_in_code_blocks(const code_block_array_t *blocks, const char *str) {
+    size_t i;
+    for (i = 0; i < blocks->len; i++) {
+        if (blocks->buf[i].text != NULL && strstr(blocks->buf[i].text, str) != NULL) return TRUE;
+    }
+    return FALSE;
+}
+
+static bool_t is_inlined_rule(const node_t *rule) {
+    return ((rule->data.rule.attrs & (RULE_ATTR__SKIP | RULE_ATTR__EAGER | RULE_ATTR__INLINE)) == RULE_ATTR__INLINE) ? TRUE : FALSE;
+}
+
+static bool_t is_rule_reachable(const node_t *node, const node_t *rule, node_const_array_t *visited) { /* visited: the rules already searched */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        {
+            size_t i;
+            for (i = 0; i < visited->len; i++) {
+                if (visited->buf[i] == node) return FALSE;
+            }
+            node_const_array__add(visited, node);
+        }
+        return is_rule_reachable(node->data.rule.expr, rule, visited);
+    case NODE_REFERENCE:
+        if (node->data.reference.rule == rule) return TRUE;
+        return is_rule_reachable(node->data.reference.rule, rule, visited);
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return is_rule_reachable(node->data.quantity.expr, rule, visited);
+    case NODE_PREDICATE:
+        return is_rule_reachable(node->data.predicate.expr, rule, visited);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (is_rule_reachable(node->data.sequence.nodes.buf[i], rule, visited)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_rule_reachable(node->data.alternate.nodes.buf[i], rule, visited)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_rule_reachable(node->data.capture.expr, rule, visited);
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return is_rule_reachable(node->data.error.expr, rule, visited);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_recursive_rule(const node_t *rule) {
+    node_const_array_t a;
+    bool_t b;
+    node_const_array__init(&a);
+    b = is_rule_reachable(rule->data.rule.expr, rule, &a);
+    node_const_array__term(&a);
+    return b;
+}
+
+static bool_t is_nullable_node(const node_t *node, node_const_array_t *rules) { /* rules: the rules being examined */
+    if (node == NULL) return TRUE;
+    switch (node->type) {
+    case NODE_RULE:
+        {
+            size_t i;
+            bool_t b;
+            for (i = 0; i < rules->len; i++) {
+                if (rules->buf[i] == node) return FALSE;
+            }
+            node_const_array__add(rules, node);
+            b = is_nullable_node(node->data.rule.expr, rules);
+            rules->len--;
+            return b;
+        }
+    case NODE_REFERENCE:
+        return is_nullable_node(node->data.reference.rule, rules);
+    case NODE_STRING:
+        return (node->data.string.value == NULL || node->data.string.value[0] == '\0') ? TRUE : FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return (node->data.quantity.min <= 0) ? TRUE : is_nullable_node(node->data.quantity.expr, rules);
+    case NODE_PREDICATE:
+        return TRUE;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (!is_nullable_node(node->data.sequence.nodes.buf[i], rules)) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_nullable_node(node->data.alternate.nodes.buf[i], rules)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_nullable_node(node->data.capture.expr, rules);
+    case NODE_EXPAND:
+        return TRUE;
+    case NODE_ACTION:
+        return TRUE;
+    case NODE_ERROR:
+        return is_nullable_node(node->data.error.expr, rules);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_rule_left_reachable(const node_t *node, const node_t *rule, node_const_array_t *visited) { /* visited: the rules already searched */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        {
+            size_t i;
+            for (i = 0; i < visited->len; i++) {
+                if (visited->buf[i] == node) return FALSE;
+            }
+            node_const_array__add(visited, node);
+        }
+        return is_rule_left_reachable(node->data.rule.expr, rule, visited);
+    case NODE_REFERENCE:
+        if (node->data.reference.rule == rule) return TRUE;
+        return is_rule_left_reachable(node->data.reference.rule, rule, visited);
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return is_rule_left_reachable(node->data.quantity.expr, rule, visited);
+    case NODE_PREDICATE:
+        return is_rule_left_reachable(node->data.predicate.expr, rule, visited);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                const node_t *const n = node->data.sequence.nodes.buf[i];
+                node_const_array_t a;
+                bool_t b;
+                if (is_rule_left_reachable(n, rule, visited)) return TRUE;
+                node_const_array__init(&a);
+                b = is_nullable_node(n, &a);
+                node_const_array__term(&a);
+                if (!b) break;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_rule_left_reachable(node->data.alternate.nodes.buf[i], rule, visited)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_rule_left_reachable(node->data.capture.expr, rule, visited);
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return is_rule_left_reachable(node->data.error.expr, rule, visited);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_left_recursive_rule(const node_t *rule) {
+    node_const_array_t a;
+    bool_t b;
+    node_const_array__init(&a);
+    b = is_rule_left_reachable(rule->data.rule.expr, rule, &a);
+    node_const_array__term(&a);
+    return b;
+}
+
+static bool_t is_rule_reachable_in_predicate(const node_t *node, const node_t *rule) { /* the rules referred to are not followed */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        return is_rule_reachable_in_predicate(node->data.rule.expr, rule);
+    case NODE_REFERENCE:
+        return FALSE;
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return is_rule_reachable_in_predicate(node->data.quantity.expr, rule);
+    case NODE_PREDICATE:
+        {
+            node_const_array_t a;
+            bool_t b;
+            node_const_array__init(&a);
+            b = is_rule_reachable(node->data.predicate.expr, rule, &a);
+            node_const_array__term(&a);
+            return b;
+        }
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (is_rule_reachable_in_predicate(node->data.sequence.nodes.buf[i], rule)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_rule_reachable_in_predicate(node->data.alternate.nodes.buf[i], rule)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_rule_reachable_in_predicate(node->data.capture.expr, rule);
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return is_rule_reachable_in_predicate(node->data.error.expr, rule);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static const node_t *unwrap_capture_node(const node_t *node) {
+    while (node->type == NODE_CAPTURE) node = node->data.capture.expr;
+    return node;
+}
+
+static bool_t is_rule_committed(const node_t *node, const node_t *rule) { /* TRUE if the expression never fails after the rule matches in it */
+    const node_t *n;
+    size_t i;
+    if (node == NULL) return FALSE;
+    n = unwrap_capture_node(node);
+    if (n->type == NODE_REFERENCE) return (n->data.reference.rule == rule) ? TRUE : FALSE;
+    if (n->type != NODE_SEQUENCE) return FALSE;
+    for (i = 0; i < n->data.sequence.nodes.len; i++) {
+        const node_t *const m = unwrap_capture_node(n->data.sequence.nodes.buf[i]);
+        node_const_array_t a;
+        bool_t b;
+        if (m->type == NODE_REFERENCE && m->data.reference.rule == rule) break;
+        node_const_array__init(&a);
+        b = is_rule_reachable(m, rule, &a);
+        node_const_array__term(&a);
+        if (b) return FALSE;
+    }
+    if (i >= n->data.sequence.nodes.len) return FALSE;
+    for (i++; i < n->data.sequence.nodes.len; i++) {
+        if (!is_always_succeeding(n->data.sequence.nodes.buf[i])) return FALSE;
+    }
+    return TRUE;
+}
+
+static bool_t is_rule_reachable_in_backtracking(const node_t *node, const node_t *rule) { /* the rules referred to are not followed */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        return is_rule_reachable_in_backtracking(node->data.rule.expr, rule);
+    case NODE_REFERENCE:
+        return FALSE;
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        if (!is_rule_committed(node->data.quantity.expr, rule)) {
+            node_const_array_t a;
+            bool_t b;
+            node_const_array__init(&a);
+            b = is_rule_reachable(node->data.quantity.expr, rule, &a);
+            node_const_array__term(&a);
+            if (b) return TRUE;
+        }
+        return is_rule_reachable_in_backtracking(node->data.quantity.expr, rule);
+    case NODE_PREDICATE:
+        return FALSE;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (is_rule_reachable_in_backtracking(node->data.sequence.nodes.buf[i], rule)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                const node_t *const n = node->data.alternate.nodes.buf[i];
+                if (i + 1 < node->data.alternate.nodes.len && !is_rule_committed(n, rule)) {
+                    node_const_array_t a;
+                    bool_t b;
+                    node_const_array__init(&a);
+                    b = is_rule_reachable(n, rule, &a);
+                    node_const_array__term(&a);
+                    if (b) return TRUE;
+                }
+                if (is_rule_reachable_in_backtracking(n, rule)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_rule_reachable_in_backtracking(node->data.capture.expr, rule);
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return is_rule_reachable_in_backtracking(node->data.error.expr, rule);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static size_t count_charclass_items(const char *value) { /* counts the characters and the character ranges in the character class */
+    const size_t n = (value != NULL) ? strlen(value) : 0;
+    size_t i = (n > 0 && value[0] == '^') ? 1 : 0, k = 0;
+    while (i < n) {
+        int u = 0;
+        if (value[i] == '\\' && i + 1 < n) i++;
+        i += utf8_to_utf32(value + i, &u);
+        if (i + 1 < n && value[i] == '-') { /* character range */
+            i++;
+            if (value[i] == '\\' && i + 1 < n) i++;
+            i += utf8_to_utf32(value + i, &u);
+        }
+        k++;
+    }
+    return (k > 0) ? k : 1;
+}
+
+static size_t weigh_nodes(const node_t *node, bool_t inlined) { /* returns the rough size of the code generated for the nodes */
+    /* inlined: TRUE to expand the references to the inlined rules */
+    if (node == NULL) return 0;
+    switch (node->type) {
+    case NODE_RULE:
+        return weigh_nodes(node->data.rule.expr, inlined);
+    case NODE_REFERENCE:
+        if (inlined && node->data.reference.index == VOID_VALUE && is_inlined_rule(node->data.reference.rule))
+            return weigh_nodes(node->data.reference.rule, inlined);
+        return 1;
+    case NODE_STRING:
+        return (node->data.string.value != NULL && node->data.string.value[0] != '\0') ? strlen(node->data.string.value) : 1;
+    case NODE_CHARCLASS:
+        return count_charclass_items(node->data.charclass.value);
+    case NODE_QUANTITY:
+        return 1 + weigh_nodes(node->data.quantity.expr, inlined);
+    case NODE_PREDICATE:
+        return 1 + weigh_nodes(node->data.predicate.expr, inlined);
+    case NODE_SEQUENCE:
+        {
+            size_t n = 1, i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                n += weigh_nodes(node->data.sequence.nodes.buf[i], inlined);
+            }
+            return n;
+        }
+    case NODE_ALTERNATE:
+        {
+            size_t n = 1, i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                n += weigh_nodes(node->data.alternate.nodes.buf[i], inlined);
+            }
+            return n;
+        }
+    case NODE_CAPTURE:
+        return 1 + weigh_nodes(node->data.capture.expr, inlined);
+    case NODE_EXPAND:
+        return 1;
+    case NODE_ACTION:
+        return 1;
+    case NODE_ERROR:
+        return 1 + weigh_nodes(node->data.error.expr, inlined);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static size_t count_max_charclass_items(const node_t *node) { /* returns the item count of the largest character class in the inlined rule */
+    if (node == NULL) return 0;
+    switch (node->type) {
+    case NODE_RULE:
+        return count_max_charclass_items(node->data.rule.expr);
+    case NODE_REFERENCE:
+        if (node->data.reference.index == VOID_VALUE && is_inlined_rule(node->data.reference.rule))
+            return count_max_charclass_items(node->data.reference.rule);
+        return 0;
+    case NODE_STRING:
+        return 0;
+    case NODE_CHARCLASS:
+        return count_charclass_items(node->data.charclass.value);
+    case NODE_QUANTITY:
+        return count_max_charclass_items(node->data.quantity.expr);
+    case NODE_PREDICATE:
+        return count_max_charclass_items(node->data.predicate.expr);
+    case NODE_SEQUENCE:
+        {
+            size_t n = 0, i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                const size_t k = count_max_charclass_items(node->data.sequence.nodes.buf[i]);
+                if (n < k) n = k;
+            }
+            return n;
+        }
+    case NODE_ALTERNATE:
+        {
+            size_t n = 0, i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                const size_t k = count_max_charclass_items(node->data.alternate.nodes.buf[i]);
+                if (n < k) n = k;
+            }
+            return n;
+        }
+    case NODE_CAPTURE:
+        return count_max_charclass_items(node->data.capture.expr);
+    case NODE_EXPAND:
+        return 0;
+    case NODE_ACTION:
+        return 0;
+    case NODE_ERROR:
+        return count_max_charclass_items(node->data.error.expr);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static node_t *find_largest_auto_inlined_rule(const node_t *node) { /* returns NULL if no rules inlined automatically are referred to */
+    if (node == NULL) return NULL;
+    switch (node->type) {
+    case NODE_RULE:
+        return find_largest_auto_inlined_rule(node->data.rule.expr);
+    case NODE_REFERENCE:
+        if (
+            node->data.reference.index == VOID_VALUE && is_inlined_rule(node->data.reference.rule) &&
+            (node->data.reference.rule->data.rule.attrs & RULE_ATTR__AUTO_INLINE)
+        ) return (node_t *)node->data.reference.rule;
+        return NULL;
+    case NODE_STRING:
+        return NULL;
+    case NODE_CHARCLASS:
+        return NULL;
+    case NODE_QUANTITY:
+        return find_largest_auto_inlined_rule(node->data.quantity.expr);
+    case NODE_PREDICATE:
+        return find_largest_auto_inlined_rule(node->data.predicate.expr);
+    case NODE_SEQUENCE:
+    case NODE_ALTERNATE:
+        {
+            const node_array_t *const a = (node->type == NODE_SEQUENCE) ? &node->data.sequence.nodes : &node->data.alternate.nodes;
+            node_t *r = NULL;
+            size_t n = 0, i;
+            for (i = 0; i < a->len; i++) {
+                node_t *const q = find_largest_auto_inlined_rule(a->buf[i]);
+                if (q != NULL) {
+                    const size_t k = weigh_nodes(q, TRUE);
+                    if (r == NULL || n < k) {
+                        r = q;
+                        n = k;
+                    }
+                }
+            }
+            return r;
+        }
+    case NODE_CAPTURE:
+        return find_largest_auto_inlined_rule(node->data.capture.expr);
+    case NODE_EXPAND:
+        return NULL;
+    case NODE_ACTION:
+        return NULL;
+    case NODE_ERROR:
+        return find_largest_auto_inlined_rule(node->data.error.expr);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static void limit_inlining_growth(node_t *rule) {
+    /* stops inlining the largest rules inlined automatically until the growth of the rule by inlining is within the limit */
+    while (weigh_nodes(rule, TRUE) > weigh_nodes(rule, FALSE) + INLINE_MAX_GROWTH) {
+        node_t *const r = find_largest_auto_inlined_rule(rule);
+        if (r == NULL) break; /* only the rules specified by %inline */
+        r->data.rule.attrs &= ~(RULE_ATTR__INLINE | RULE_ATTR__AUTO_INLINE);
+    }
+}
+
+static void decide_inlining(node_t *node, node_const_array_t *done) { /* done: the rules already decided */
+    if (node == NULL) return;
+    switch (node->type) {
+    case NODE_RULE:
+        {
+            size_t i;
+            for (i = 0; i < done->len; i++) {
+                if (done->buf[i] == node) return;
+            }
+            node_const_array__add(done, node);
+            if (node->data.rule.attrs & (RULE_ATTR__SKIP | RULE_ATTR__INLINE)) {
+                if (node->data.rule.attrs & RULE_ATTR__INLINE) decide_inlining(node->data.rule.expr, done); /* by %inline */
+                return;
+            }
+            if (!is_pure_rule(node) || is_recursive_rule(node)) return;
+            decide_inlining(node->data.rule.expr, done); /* decides the referenced rules first */
+            if (weigh_nodes(node, TRUE) <= INLINE_MAX_NODES && count_max_charclass_items(node) <= INLINE_MAX_CHARCLASS_ITEMS)
+                node->data.rule.attrs |= RULE_ATTR__INLINE | RULE_ATTR__AUTO_INLINE;
+        }
+        break;
+    case NODE_REFERENCE:
+        decide_inlining((node_t *)node->data.reference.rule, done);
+        break;
+    case NODE_STRING:
+        break;
+    case NODE_CHARCLASS:
+        break;
+    case NODE_QUANTITY:
+        decide_inlining(node->data.quantity.expr, done);
+        break;
+    case NODE_PREDICATE:
+        decide_inlining(node->data.predicate.expr, done);
+        break;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                decide_inlining(node->data.sequence.nodes.buf[i], done);
+            }
+        }
+        break;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                decide_inlining(node->data.alternate.nodes.buf[i], done);
+            }
+        }
+        break;
+    case NODE_CAPTURE:
+        decide_inlining(node->data.capture.expr, done);
+        break;
+    case NODE_EXPAND:
+        break;
+    case NODE_ACTION:
+        break;
+    case NODE_ERROR:
+        decide_inlining(node->data.error.expr, done);
+        break;
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_thunkless_node(const node_t *node) {
+    if (node == NULL) return TRUE;
+    switch (node->type) {
+    case NODE_RULE:
+        return is_thunkless_node(node->data.rule.expr);
+    case NODE_REFERENCE:
+        if (node->data.reference.index != VOID_VALUE) return FALSE;
+        return (node->data.reference.rule->data.rule.attrs & (RULE_ATTR__SKIP | RULE_ATTR__THUNKLESS)) ? TRUE : FALSE;
+    case NODE_STRING:
+        return TRUE;
+    case NODE_CHARCLASS:
+        return TRUE;
+    case NODE_QUANTITY:
+        return is_thunkless_node(node->data.quantity.expr);
+    case NODE_PREDICATE:
+        return is_thunkless_node(node->data.predicate.expr);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (!is_thunkless_node(node->data.sequence.nodes.buf[i])) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (!is_thunkless_node(node->data.alternate.nodes.buf[i])) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_CAPTURE:
+        return FALSE;
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return FALSE;
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static void mark_thunkless_rules(context_t *ctx) {
+    bool_t b = TRUE;
+    size_t i;
+    for (i = 0; i < ctx->rules.len; i++) {
+        ctx->rules.buf[i]->data.rule.attrs |= RULE_ATTR__THUNKLESS;
+    }
+    while (b) { /* removes the mark from the rules referring to unmarked rules until nothing changes */
+        b = FALSE;
+        for (i = 0; i < ctx->rules.len; i++) {
+            node_t *const rule = ctx->rules.buf[i];
+            if (!(rule->data.rule.attrs & RULE_ATTR__THUNKLESS) || is_thunkless_node(rule)) continue;
+            rule->data.rule.attrs &= ~RULE_ATTR__THUNKLESS;
+            b = TRUE;
+        }
+    }
+}
+
+static bool_t is_factorable_node(const node_t *node1, const node_t *node2) { /* TRUE if identical and free of actions, captures, and variables */
+    if (node1->type != node2->type) return FALSE;
+    switch (node1->type) {
+    case NODE_RULE:
+        return FALSE;
+    case NODE_REFERENCE:
+        return (
+            node1->data.reference.var == NULL && node2->data.reference.var == NULL &&
+            node1->data.reference.rule != NULL && node1->data.reference.rule == node2->data.reference.rule
+        ) ? TRUE : FALSE;
+    case NODE_STRING:
+        return (strcmp(node1->data.string.value, node2->data.string.value) == 0) ? TRUE : FALSE;
+    case NODE_CHARCLASS:
+        if (node1->data.charclass.value == NULL || node2->data.charclass.value == NULL)
+            return (node1->data.charclass.value == node2->data.charclass.value) ? TRUE : FALSE;
+        return (strcmp(node1->data.charclass.value, node2->data.charclass.value) == 0) ? TRUE : FALSE;
+    case NODE_QUANTITY:
+        return (
+            node1->data.quantity.min == node2->data.quantity.min && node1->data.quantity.max == node2->data.quantity.max &&
+            is_factorable_node(node1->data.quantity.expr, node2->data.quantity.expr)
+        ) ? TRUE : FALSE;
+    case NODE_PREDICATE:
+        return (
+            node1->data.predicate.neg == node2->data.predicate.neg &&
+            is_factorable_node(node1->data.predicate.expr, node2->data.predicate.expr)
+        ) ? TRUE : FALSE;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            if (node1->data.sequence.nodes.len != node2->data.sequence.nodes.len) return FALSE;
+            for (i = 0; i < node1->data.sequence.nodes.len; i++) {
+                if (!is_factorable_node(node1->data.sequence.nodes.buf[i], node2->data.sequence.nodes.buf[i])) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            if (node1->data.alternate.nodes.len != node2->data.alternate.nodes.len) return FALSE;
+            for (i = 0; i < node1->data.alternate.nodes.len; i++) {
+                if (!is_factorable_node(node1->data.alternate.nodes.buf[i], node2->data.alternate.nodes.buf[i])) return FALSE;
+            }
+        }
+        return TRUE;
+    case NODE_CAPTURE:
+        return FALSE;
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return FALSE;
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t has_side_effect(const node_t *node) { /* TRUE if the node contains actions, error actions, captures, or variables */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        return has_side_effect(node->data.rule.expr);
+    case NODE_REFERENCE:
+        return (node->data.reference.var != NULL) ? TRUE : FALSE;
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return has_side_effect(node->data.quantity.expr);
+    case NODE_PREDICATE:
+        return has_side_effect(node->data.predicate.expr);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (has_side_effect(node->data.sequence.nodes.buf[i])) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (has_side_effect(node->data.alternate.nodes.buf[i])) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return TRUE;
+    case NODE_EXPAND:
+        return FALSE;
+    case NODE_ACTION:
+        return TRUE;
+    case NODE_ERROR:
+        return TRUE;
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static size_t count_sequence_elements(const node_t *node) { /* a node other than a sequence is regarded as a sequence with one element */
+    return (node->type == NODE_SEQUENCE) ? node->data.sequence.nodes.len : 1;
+}
+
+static node_t *get_sequence_element(node_t *node, size_t index) {
+    return (node->type == NODE_SEQUENCE) ? node->data.sequence.nodes.buf[index] : node;
+}
+
+static node_t *detach_sequence_prefix(node_t *node, size_t num, bool_t keep) {
+    /* removes the first num elements, which are destroyed unless keep is TRUE, and returns the remaining part */
+    if (node->type != NODE_SEQUENCE) {
+        assert(num == 1);
+        if (!keep) destroy_node(node);
+        return create_node(NODE_SEQUENCE); /* empty sequence */
+    }
+    {
+        node_array_t *const nodes = &node->data.sequence.nodes;
+        size_t i;
+        if (!keep) {
+            for (i = 0; i < num; i++) destroy_node(nodes->buf[i]);
+        }
+        for (i = num; i < nodes->len; i++) nodes->buf[i - num] = nodes->buf[i];
+        nodes->len -= num;
+        if (nodes->len == 1) {
+            node_t *const e = nodes->buf[0];
+            nodes->len = 0;
+            destroy_node(node);
+            return e;
+        }
+    }
+    return node;
+}
+
+static node_t *rewrite_nodes(context_t *ctx, node_t *rule, node_t *node, node_rewriter_t func, bool_t *changed) {
+    /* applies func to all nodes in post-order; returns the node replacing the given node */
+    if (node == NULL) return NULL;
+    switch (node->type) {
+    case NODE_RULE:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    case NODE_REFERENCE:
+        break;
+    case NODE_STRING:
+        break;
+    case NODE_CHARCLASS:
+        break;
+    case NODE_QUANTITY:
+        node->data.quantity.expr = rewrite_nodes(ctx, rule, node->data.quantity.expr, func, changed);
+        break;
+    case NODE_PREDICATE:
+        node->data.predicate.expr = rewrite_nodes(ctx, rule, node->data.predicate.expr, func, changed);
+        break;
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                node->data.sequence.nodes.buf[i] = rewrite_nodes(ctx, rule, node->data.sequence.nodes.buf[i], func, changed);
+            }
+        }
+        break;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                node->data.alternate.nodes.buf[i] = rewrite_nodes(ctx, rule, node->data.alternate.nodes.buf[i], func, changed);
+            }
+        }
+        break;
+    case NODE_CAPTURE:
+        node->data.capture.expr = rewrite_nodes(ctx, rule, node->data.capture.expr, func, changed);
+        break;
+    case NODE_EXPAND:
+        break;
+    case NODE_ACTION:
+        break;
+    case NODE_ERROR:
+        node->data.error.expr = rewrite_nodes(ctx, rule, node->data.error.expr, func, changed);
+        break;
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+    return func(ctx, rule, node, changed);
+}
+
+static node_t *unwrap_single_node(node_t *node) { /* replaces a sequence or an alternate with one element by the element */
+    node_array_t *const nodes =
+        (node->type == NODE_SEQUENCE) ? &node->data.sequence.nodes :
+        (node->type == NODE_ALTERNATE) ? &node->data.alternate.nodes : NULL;
+    if (nodes != NULL && nodes->len == 1) {
+        node_t *const e = nodes->buf[0];
+        nodes->len = 0;
+        destroy_node(node);
+        return e;
+    }
+    return node;
+}
+
+static node_t *simplify_predicate(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* !!e -> &e, !&e -> !e, &!e -> !e, &&e -> &e */
+    if (node->type != NODE_PREDICATE || node->data.predicate.expr->type != NODE_PREDICATE) return node;
+    {
+        node_t *const e = node->data.predicate.expr;
+        e->data.predicate.neg = (node->data.predicate.neg != e->data.predicate.neg) ? TRUE : FALSE;
+        node->data.predicate.expr = NULL;
+        destroy_node(node);
+        *changed = TRUE;
+        return e;
+    }
+}
+
+static node_t *simplify_quantifier(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* (e*)+ -> e*, (e+)? -> e*, (e?)? -> e?, etc. */
+    if (node->type != NODE_QUANTITY || node->data.quantity.expr->type != NODE_QUANTITY) return node;
+    {
+        node_t *const e = node->data.quantity.expr;
+        const int min1 = node->data.quantity.min, max1 = node->data.quantity.max;
+        const int min2 = e->data.quantity.min, max2 = e->data.quantity.max;
+        if (min1 < 0 || min1 > 1 || (max1 != 1 && max1 >= 0)) return node; /* neither ?, *, nor + */
+        if (min2 < 0 || min2 > 1 || (max2 != 1 && max2 >= 0)) return node;
+        e->data.quantity.min = (min1 > 0 && min2 > 0) ? 1 : 0;
+        e->data.quantity.max = (max1 == 1 && max2 == 1) ? 1 : -1;
+        node->data.quantity.expr = NULL;
+        destroy_node(node);
+        *changed = TRUE;
+        return e;
+    }
+}
+
+static node_t *concatenate_strings(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* 'ab' 'cd' -> 'abcd' */
+    if (node->type != NODE_SEQUENCE) return node;
+    {
+        node_array_t *const nodes = &node->data.sequence.nodes;
+        size_t i, j;
+        for (j = 0, i = 0; i < nodes->len; i++) {
+            if (j > 0 && nodes->buf[j - 1]->type == NODE_STRING && nodes->buf[i]->type == NODE_STRING) {
+                node_t *const n_s = nodes->buf[j - 1];
+                const size_t l = strlen(n_s->data.string.value);
+                const size_t m = strlen(nodes->buf[i]->data.string.value);
+                n_s->data.string.value = (char *)realloc_e(n_s->data.string.value, l + m + 1);
+                memcpy(n_s->data.string.value + l, nodes->buf[i]->data.string.value, m + 1);
+                destroy_node(nodes->buf[i]);
+                *changed = TRUE;
+            }
+            else {
+                nodes->buf[j++] = nodes->buf[i];
+            }
+        }
+        nodes->len = j;
+    }
+    return unwrap_single_node(node);
+}
+
+static node_t *eliminate_unreachable_alternatives(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) {
+    /* removes the alternatives following one that always succeeds, if they are free of actions, captures, and variables */
+    if (node->type != NODE_ALTERNATE) return node;
+    {
+        node_array_t *const nodes = &node->data.alternate.nodes;
+        size_t i, j;
+        for (i = 0; i < nodes->len; i++) {
+            if (is_always_succeeding(nodes->buf[i])) break;
+        }
+        if (i >= nodes->len) return node;
+        for (j = ++i; i < nodes->len; i++) {
+            if (!has_side_effect(nodes->buf[i])) {
+                destroy_node(nodes->buf[i]);
+                *changed = TRUE;
+            }
+            else {
+                nodes->buf[j++] = nodes->buf[i];
+            }
+        }
+        nodes->len = j;
+    }
+    return unwrap_single_node(node);
+}
+
+static bool_t is_expanded(const node_t *node, size_t index) { /* TRUE if the capture is referred to by an expansion such as $1 */
+    if (node == NULL) return FALSE;
+    switch (node->type) {
+    case NODE_RULE:
+        return is_expanded(node->data.rule.expr, index);
+    case NODE_REFERENCE:
+        return FALSE;
+    case NODE_STRING:
+        return FALSE;
+    case NODE_CHARCLASS:
+        return FALSE;
+    case NODE_QUANTITY:
+        return is_expanded(node->data.quantity.expr, index);
+    case NODE_PREDICATE:
+        return is_expanded(node->data.predicate.expr, index);
+    case NODE_SEQUENCE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                if (is_expanded(node->data.sequence.nodes.buf[i], index)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_ALTERNATE:
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                if (is_expanded(node->data.alternate.nodes.buf[i], index)) return TRUE;
+            }
+        }
+        return FALSE;
+    case NODE_CAPTURE:
+        return is_expanded(node->data.capture.expr, index);
+    case NODE_EXPAND:
+        return (node->data.expand.index == index) ? TRUE : FALSE;
+    case NODE_ACTION:
+        return FALSE;
+    case NODE_ERROR:
+        return is_expanded(node->data.error.expr, index);
+    default:
+        print_error("Internal error [%d]\n", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static bool_t is_capture_referred(const char *text, size_t index) { /* TRUE if $n (converted to _n) possibly refers to the capture */
+    size_t i;
+    if (text == NULL) return FALSE;
+    for (i = 0; text[i]; i++) {
+        if (text[i] == '_' && (i == 0 || !(
+            (text[i - 1] >= 'a' && text[i - 1] <= 'z') ||
+            (text[i - 1] >= 'A' && text[i - 1] <= 'Z') ||
+            (text[i - 1] >= '0' && text[i - 1] <= '9') ||
+            text[i - 1] == '_'
+        ))) {
+            size_t n = 0, j;
+            for (j = i + 1; text[j] >= '0' && text[j] <= '9'; j++) n = n * 10 + (size_t)(text[j] - '0');
+            if (j > i + 1 && n == index + 1) return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static bool_t is_capture_referred_in_code_blocks(const code_block_array_t *blocks, size_t index) {
+    size_t i;
+    for (i = 0; i < blocks->len; i++) {
+        if (is_capture_referred(blocks->buf[i].text, index)) return TRUE;
+    }
+    return FALSE;
+}
+
+static node_t *remove_redundant_capture(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* <e> -> e if $n is never used */
+    if (node->type != NODE_CAPTURE) return node;
+    if (ctx->flags & CODE_FLAG__EVENT) return node; /* every capture delivers the token event for %event */
+    {
+        node_const_array_t *const capts = &rule->data.rule.capts;
+        const size_t index = node->data.capture.index;
+        size_t i;
+        for (i = 0; i < rule->data.rule.codes.len; i++) {
+            const node_t *const code = rule->data.rule.codes.buf[i];
+            if (is_capture_referred(((code->type == NODE_ACTION) ? &code->data.action.code : &code->data.error.code)->text, index)) return node;
+        }
+        if (
+            is_expanded(rule, index) ||
+            is_capture_referred_in_code_blocks(&ctx->esource, index) || is_capture_referred_in_code_blocks(&ctx->eheader, index) ||
+            is_capture_referred_in_code_blocks(&ctx->source, index) || is_capture_referred_in_code_blocks(&ctx->header, index)
+        ) return node;
+        {
+            node_t *const e = node->data.capture.expr;
+            for (i = 0; i < rule->data.rule.codes.len; i++) {
+                node_t *const code = (node_t *)rule->data.rule.codes.buf[i];
+                node_const_array_t *const a = (code->type == NODE_ACTION) ? &code->data.action.capts : &code->data.error.capts;
+                size_t j, k;
+                for (k = 0, j = 0; j < a->len; j++) {
+                    if (a->buf[j] != node) a->buf[k++] = a->buf[j];
+                }
+                a->len = k;
+            }
+            node->data.capture.expr = NULL;
+            destroy_node(node);
+            capts->buf[index] = NULL; /* the index is kept to leave $n of the other captures unchanged */
+            while (capts->len > 0 && capts->buf[capts->len - 1] == NULL) capts->len--;
+            *changed = TRUE;
+            return e;
+        }
+    }
+}
+
+static void append_charclass_character(char_array_t *array, const char *str, size_t len) {
+    size_t i;
+    if (len == 1 && (str[0] == '\\' || str[0] == '^' || str[0] == '-')) char_array__add(array, '\\');
+    for (i = 0; i < len; i++) char_array__add(array, str[i]);
+}
+
+static void append_charclass_items(char_array_t *array, const char *value, bool_t ascii) {
+    /* re-escapes the items of a positive character class so that they keep their meaning when concatenated */
+    const size_t n = strlen(value);
+    size_t i = 0;
+    while (i < n) {
+        size_t k;
+        if (value[i] == '\\' && i + 1 < n) i++;
+        k = ascii ? 1 : utf8_to_utf32(value + i, NULL);
+        if (k > n - i) k = n - i;
+        append_charclass_character(array, value + i, k);
+        i += k;
+        if (i + 1 < n && value[i] == '-') { /* range */
+            size_t j = i + 1;
+            if (!ascii && value[j] == '\\' && j + 1 < n) j++;
+            k = ascii ? 1 : utf8_to_utf32(value + j, NULL);
+            if (k > n - j) k = n - j;
+            for (; i < j + k; i++) char_array__add(array, value[i]);
+        }
+    }
+}
+
+static bool_t is_single_character_node(const node_t *node, bool_t ascii) { /* TRUE if the node always matches just one character if succeeding */
+    if (node->type == NODE_STRING) {
+        const char *const value = node->data.string.value;
+        const size_t n = strlen(value);
+        if (n == 0) return FALSE;
+        return (ascii ? (n == 1) : (is_valid_utf8_string(value) && utf8_to_utf32(value, NULL) == n)) ? TRUE : FALSE;
+    }
+    if (node->type == NODE_CHARCLASS) {
+        const char *const value = node->data.charclass.value;
+        return (value != NULL && value[0] != '\0' && value[0] != '^') ? TRUE : FALSE;
+    }
+    return FALSE;
+}
+
+static node_t *merge_charclasses(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* 'a' / [b-d] / 'e' -> [ab-de] */
+    if (node->type != NODE_ALTERNATE) return node;
+    {
+        node_array_t *const nodes = &node->data.alternate.nodes;
+        const bool_t ascii = ctx->opts.ascii;
+        size_t i, j, k, l;
+        for (j = 0, i = 0; i < nodes->len; i = k) {
+            for (k = i; k < nodes->len && is_single_character_node(nodes->buf[k], ascii); k++);
+            if (k - i < 2) {
+                if (k == i) k++;
+                for (l = i; l < k; l++) nodes->buf[j++] = nodes->buf[l];
+                continue;
+            }
+            {
+                node_t *const n_c = create_node(NODE_CHARCLASS);
+                char_array_t a;
+                char_array__init(&a);
+                for (l = i; l < k; l++) {
+                    const node_t *const e = nodes->buf[l];
+                    if (e->type == NODE_STRING)
+                        append_charclass_character(&a, e->data.string.value, strlen(e->data.string.value));
+                    else
+                        append_charclass_items(&a, e->data.charclass.value, ascii);
+                    destroy_node(nodes->buf[l]);
+                }
+                n_c->data.charclass.value = strndup_e(a.buf, a.len);
+                char_array__term(&a);
+                if (!ascii && !is_ascii_string(n_c->data.charclass.value)) ctx->flags |= CODE_FLAG__UTF8_CHARCLASS_USED;
+                nodes->buf[j++] = n_c;
+                *changed = TRUE;
+            }
+        }
+        nodes->len = j;
+    }
+    return unwrap_single_node(node);
+}
+
+static node_t *factor_alternatives(context_t *ctx, node_t *rule, node_t *node, bool_t *changed) { /* A B / A C -> A (B / C) */
+    if (node->type != NODE_ALTERNATE) return node;
+    {
+        node_array_t *const nodes = &node->data.alternate.nodes;
+        size_t i, j, k, l, n;
+        for (i = 0; i + 1 < nodes->len; i++) {
+            if (count_sequence_elements(nodes->buf[i]) == 0) continue;
+            n = count_sequence_elements(nodes->buf[i]);
+            for (j = i + 1; j < nodes->len; j++) { /* only adjacent alternatives can be factored to keep the ordered choice */
+                const size_t m = count_sequence_elements(nodes->buf[j]);
+                if (m == 0 || !is_factorable_node(get_sequence_element(nodes->buf[i], 0), get_sequence_element(nodes->buf[j], 0))) break;
+                if (n > m) n = m;
+            }
+            if (j - i < 2) continue;
+            for (k = 1; k < n; k++) {
+                for (l = i + 1; l < j; l++) {
+                    if (!is_factorable_node(get_sequence_element(nodes->buf[i], k), get_sequence_element(nodes->buf[l], k))) break;
+                }
+                if (l < j) break;
+            }
+            n = k; /* the length of the common prefix */
+            {
+                node_t *const n_s = create_node(NODE_SEQUENCE);
+                node_t *const n_a = create_node(NODE_ALTERNATE);
+                for (k = 0; k < n; k++) {
+                    node_array__add(&n_s->data.sequence.nodes, get_sequence_element(nodes->buf[i], k));
+                }
+                for (l = i; l < j; l++) {
+                    node_array__add(&n_a->data.alternate.nodes, detach_sequence_prefix(nodes->buf[l], n, (l == i) ? TRUE : FALSE));
+                }
+                {
+                    node_t *const n_r = eliminate_unreachable_alternatives(ctx, rule, factor_alternatives(ctx, rule, n_a, changed), changed);
+                    if (count_sequence_elements(n_r) > 0)
+                        node_array__add(&n_s->data.sequence.nodes, n_r);
+                    else
+                        destroy_node(n_r); /* A (() / B) -> A if B is unreachable */
+                }
+                nodes->buf[i] = unwrap_single_node(n_s);
+                for (l = j; l < nodes->len; l++) nodes->buf[l - (j - i - 1)] = nodes->buf[l];
+                nodes->len -= j - i - 1;
+            }
+            *changed = TRUE;
+        }
+    }
+    return unwrap_single_node(node);
+}
+
+static void dump_escaped_string(const char *str) {
+    char s[5];
+    if (str == NULL) {
+        fprintf(stdout, "null");
+        return;
+    }
+    while (*str) {
+        fprintf(stdout, "%s", escape_character(*str++, &s));
+    }
+}
+
+static void dump_integer_value(size_t value) {
+    if (value == VOID_VALUE) {
+        fprintf(stdout, "void");
+    }
+    else {
+        fprintf(stdout, FMT_LU, (ulong_t)value);
+    }
+}
+
+static void dump_node(context_t *ctx, const node_t *node, const int indent) {
+    if (node == NULL) return;
+    switch (node->type) {
+    case NODE_RULE:
+        fprintf(stdout, "%*sRule(name:'%s', ref:%d, vars.len:" FMT_LU ", capts.len:" FMT_LU ", codes.len:" FMT_LU ") {\n",
+            indent, "", node->data.rule.name, node->data.rule.ref,
+            (ulong_t)node->data.rule.vars.len, (ulong_t)node->data.rule.capts.len, (ulong_t)node->data.rule.codes.len);
+        dump_node(ctx, node->data.rule.expr, indent + 2);
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_REFERENCE:
+        fprintf(stdout, "%*sReference(var:'%s', index:", indent, "", node->data.reference.var);
+        dump_integer_value(node->data.reference.index);
+        fprintf(stdout, ", name:'%s', rule:'%s')\n", node->data.reference.name,
+            (node->data.reference.rule) ? node->data.reference.rule->data.rule.name : NULL);
+        break;
+    case NODE_STRING:
+        fprintf(stdout, "%*sString(value:'", indent, "");
+        dump_escaped_string(node->data.string.value);
+        fprintf(stdout, "')\n");
+        break;
+    case NODE_CHARCLASS:
+        fprintf(stdout, "%*sCharclass(value:'", indent, "");
+        dump_escaped_string(node->data.charclass.value);
+        fprintf(stdout, "')\n");
+        break;
+    case NODE_QUANTITY:
+        fprintf(stdout, "%*sQuantity(min:%d, max:%d) {\n", indent, "", node->data.quantity.min, node->data.quantity.max);
+        dump_node(ctx, node->data.quantity.expr, indent + 2);
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_PREDICATE:
+        fprintf(stdout, "%*sPredicate(neg:%d) {\n", indent, "", node->data.predicate.neg);
+        dump_node(ctx, node->data.predicate.expr, indent + 2);
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_SEQUENCE:
+        fprintf(stdout, "%*sSequence(max:" FMT_LU ", len:" FMT_LU ") {\n",
+            indent, "", (ulong_t)node->data.sequence.nodes.max, (ulong_t)node->data.sequence.nodes.len);
+        {
+            size_t i;
+            for (i = 0; i < node->data.sequence.nodes.len; i++) {
+                dump_node(ctx, node->data.sequence.nodes.buf[i], indent + 2);
+            }
+        }
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_ALTERNATE:
+        fprintf(stdout, "%*sAlternate(max:" FMT_LU ", len:" FMT_LU ") {\n",
+            indent, "", (ulong_t)node->data.alternate.nodes.max, (ulong_t)node->data.alternate.nodes.len);
+        {
+            size_t i;
+            for (i = 0; i < node->data.alternate.nodes.len; i++) {
+                dump_node(ctx, node->data.alternate.nodes.buf[i], indent + 2);
+            }
+        }
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_CAPTURE:
+        fprintf(stdout, "%*sCapture(index:", indent, "");
+        dump_integer_value(node->data.capture.index);
+        fprintf(stdout, ") {\n");
+        dump_node(ctx, node->data.capture.expr, indent + 2);
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    case NODE_EXPAND:
+        fprintf(stdout, "%*sExpand(index:", indent, "");
+        dump_integer_value(node->data.expand.index);
+        fprintf(stdout, ")\n");
+        break;
+    case NODE_ACTION:
+        fprintf(stdout, "%*sAction(index:", indent, "");
+        dump_integer_value(node->data.action.index);
+        fprintf(stdout, ", code:{");
+        dump_escaped_string(node->data.action.code.text);
+        fprintf(stdout, "}, vars:");
+        if (node->data.action.vars.len + node->data.action.capts.len > 0) {
+            size_t i;
+            fprintf(stdout, "\n");
+            for (i = 0; i < node->data.action.vars.len; i++) {
+                fprintf(stdout, "%*s'%s'\n", indent + 2, "", node->data.action.vars.buf[i]->data.reference.var);
+            }
+            for (i = 0; i < node->data.action.capts.len; i++) {
+                fprintf(stdout, "%*s$" FMT_LU "\n", indent + 2, "", (ulong_t)(node->data.action.capts.buf[i]->data.capture.index + 1));
+            }
+            fprintf(stdout, "%*s)\n", indent, "");
+        }
+        else {
+            fprintf(stdout, "none)\n");
+        }
+        break;
+    case NODE_ERROR:
+        fprintf(stdout, "%*sError(index:", indent, "");
+        dump_integer_value(node->data.error.index);
+        fprintf(stdout, ", code:{");
+        dump_escaped_string(node->data.error.code.text);
+        fprintf(stdout, "}, vars:\n");
+        {
+            size_t i;
+            for (i = 0; i < node->data.error.vars.len; i++) {
+                fprintf(stdout, "%*s'%s'\n", indent + 2, "", node->data.error.vars.buf[i]->data.reference.var);
+            }
+            for (i = 0; i < node->data.error.capts.len; i++) {
+                fprintf(stdout, "%*s$" FMT_LU "\n", indent + 2, "", (ulong_t)(node->data.error.capts.buf[i]->data.capture.index + 1));
+            }
+        }
+        fprintf(stdout, "%*s) {\n", indent, "");
+        dump_node(ctx, node->data.error.expr, indent + 2);
+        fprintf(stdout, "%*s}\n", indent, "");
+        break;
+    default:
+        print_error("%*sInternal error [%d]\n", indent, "", __LINE__);
+        exit_e(-1);
+    }
+}
+
+static size_t refill_buffer(context_t *ctx, size_t num) {
+    if (ctx->buffer.len >= ctx->bufcur + num) return ctx->buffer.len - ctx->bufcur;
+    while (ctx->buffer.len < ctx->bufcur + num) {
+        int c = EOF;
+        if (ctx->ifile != NULL) {
+            c = fgetc_e(ctx->ifile);
+        }
+        else if (ctx->ilen > 0) {
+            c = (int)(unsigned char)*ctx->itext++;
+            ctx->ilen--;
+        }
+        if (c == EOF) break;
+        char_array__add(&ctx->buffer, (char)c);
+    }
+    return ctx->buffer.len - ctx->bufcur;
+}
+
+static void commit_buffer(context_t *ctx) {
+    assert(ctx->buffer.len >= ctx->bufcur);
+    if (ctx->linepos < ctx->bufpos + ctx->bufcur)
+        ctx->charnum += ctx->opts.ascii ? ctx->bufcur : count_characters(ctx->buffer.buf, 0, ctx->bufcur);
+    memmove(ctx->buffer.buf, ctx->buffer.buf + ctx->bufcur, ctx->buffer.len - ctx->bufcur);
+    ctx->buffer.len -= ctx->bufcur;
+    ctx->bufpos += ctx->bufcur;
+    ctx->bufcur = 0;
+}
 
 static bool_t match_eof(context_t *ctx) {
     return (refill_buffer(ctx, 1) < 1) ? TRUE : FALSE;
@@ -2175,7 +3715,10 @@ static node_t *parse_primary(context_t *ctx, node_t *rule) {
             print_error("%s:" FMT_LU ":" FMT_LU ": Invalid UTF-8 string\n", ctx->iname, (ulong_t)(l + 1), (ulong_t)(m + 1));
             ctx->errnum++;
         }
-        if (!ctx->opts.ascii && n_p->data.charclass.value[0] != '\0') {
+        if (
+            !ctx->opts.ascii && n_p->data.charclass.value[0] != '\0' &&
+            (n_p->data.charclass.value[0] == '^' || !is_ascii_string(n_p->data.charclass.value))
+        ) { /* ASCII-only classes that are not negated are matched bytewise */
             ctx->flags |= CODE_FLAG__UTF8_CHARCLASS_USED;
         }
     }
@@ -2522,6 +4065,45 @@ static bool_t parse_directive_string_(context_t *ctx, const char *name, char **o
     return TRUE;
 }
 
+static bool_t parse_directive_flag_(context_t *ctx, const char *name, code_flag_t flag) {
+    const size_t l = ctx->linenum;
+    const size_t m = column_number(ctx);
+    if (!match_string(ctx, name)) return FALSE;
+    match_spaces(ctx);
+    if (ctx->flags & flag) {
+        print_error("%s:" FMT_LU ":" FMT_LU ": Multiple %s definition\n", ctx->iname, (ulong_t)(l + 1), (ulong_t)(m + 1), name);
+        ctx->errnum++;
+    }
+    ctx->flags |= flag;
+    return TRUE;
+}
+
+static bool_t parse_directive_rule_(context_t *ctx, const char *name, node_array_t *output) {
+    const size_t l = ctx->linenum;
+    const size_t m = column_number(ctx);
+    if (!match_string(ctx, name)) return FALSE;
+    match_spaces(ctx);
+    {
+        const size_t p = ctx->bufcur;
+        const size_t lv = ctx->linenum;
+        const size_t mv = column_number(ctx);
+        if (match_identifier(ctx)) {
+            const size_t q = ctx->bufcur;
+            node_t *const n_p = create_node(NODE_REFERENCE);
+            match_spaces(ctx);
+            n_p->data.reference.name = strndup_e(ctx->buffer.buf + p, q - p);
+            n_p->data.reference.line = lv;
+            n_p->data.reference.col = mv;
+            node_array__add(output, n_p);
+        }
+        else {
+            print_error("%s:" FMT_LU ":" FMT_LU ": Illegal %s syntax\n", ctx->iname, (ulong_t)(l + 1), (ulong_t)(m + 1), name);
+            ctx->errnum++;
+        }
+    }
+    return TRUE;
+}
+
 static bool_t parse(context_t *ctx) {
     {
         bool_t b = TRUE;
@@ -2542,7 +4124,15 @@ static bool_t parse(context_t *ctx) {
                 parse_directive_include_(ctx, "%common", &ctx->source, &ctx->header) ||
                 parse_directive_string_(ctx, "%value", &ctx->vtype, STRING_FLAG__NOTEMPTY | STRING_FLAG__NOTVOID) ||
                 parse_directive_string_(ctx, "%auxil", &ctx->atype, STRING_FLAG__NOTEMPTY | STRING_FLAG__NOTVOID) ||
-                parse_directive_string_(ctx, "%prefix", &ctx->prefix, STRING_FLAG__NOTEMPTY | STRING_FLAG__IDENTIFIER)
+                parse_directive_string_(ctx, "%prefix", &ctx->prefix, STRING_FLAG__NOTEMPTY | STRING_FLAG__IDENTIFIER) ||
+                parse_directive_rule_(ctx, "%skip", &ctx->skips) ||
+                parse_directive_rule_(ctx, "%inline", &ctx->inlines) ||
+                parse_directive_rule_(ctx, "%eager", &ctx->eagers) ||
+                parse_directive_flag_(ctx, "%event", CODE_FLAG__EVENT) ||
+                parse_directive_flag_(ctx, "%ast", CODE_FLAG__AST) ||
+                parse_directive_flag_(ctx, "%intern", CODE_FLAG__INTERN) ||
+                parse_directive_flag_(ctx, "%arena", CODE_FLAG__ARENA) ||
+                parse_directive_flag_(ctx, "%stats", CODE_FLAG__STATS)
             ) {
                 b = TRUE;
             }
@@ -2604,6 +4194,102 @@ static bool_t parse(context_t *ctx) {
             verify_captures(ctx, ctx->rules.buf[i]->data.rule.expr, NULL);
         }
     }
+    {
+        size_t i;
+        node_const_array_t a;
+        node_const_array__init(&a);
+        for (i = 0; i < ctx->skips.len; i++) {
+            node_t *const node = ctx->skips.buf[i];
+            node->data.reference.rule = lookup_rulehash(ctx, node->data.reference.name);
+            if (node->data.reference.rule == NULL) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": No definition of rule '%s'\n",
+                    ctx->iname, (ulong_t)(node->data.reference.line + 1), (ulong_t)(node->data.reference.col + 1),
+                    node->data.reference.name);
+                ctx->errnum++;
+            }
+            else {
+                verify_skipper(ctx, (node_t *)node->data.reference.rule, &a);
+            }
+        }
+        node_const_array__term(&a);
+    }
+    {
+        size_t i;
+        for (i = 0; i < ctx->inlines.len; i++) {
+            node_t *const node = ctx->inlines.buf[i];
+            node_t *rule;
+            node->data.reference.rule = lookup_rulehash(ctx, node->data.reference.name);
+            rule = (node_t *)node->data.reference.rule;
+            if (rule == NULL) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": No definition of rule '%s'\n",
+                    ctx->iname, (ulong_t)(node->data.reference.line + 1), (ulong_t)(node->data.reference.col + 1),
+                    node->data.reference.name);
+                ctx->errnum++;
+            }
+            else if (!is_pure_rule(rule)) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Action, capture, or variable not allowed in rule '%s' for %%inline\n",
+                    ctx->iname, (ulong_t)(rule->data.rule.line + 1), (ulong_t)(rule->data.rule.col + 1), rule->data.rule.name);
+                ctx->errnum++;
+            }
+            else if (is_recursive_rule(rule)) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Recursive rule '%s' not allowed for %%inline\n",
+                    ctx->iname, (ulong_t)(rule->data.rule.line + 1), (ulong_t)(rule->data.rule.col + 1), rule->data.rule.name);
+                ctx->errnum++;
+            }
+            else {
+                rule->data.rule.attrs |= RULE_ATTR__INLINE;
+            }
+        }
+    }
+    {
+        size_t i, j;
+        for (i = 0; i < ctx->eagers.len; i++) {
+            node_t *const node = ctx->eagers.buf[i];
+            node_t *rule;
+            node->data.reference.rule = lookup_rulehash(ctx, node->data.reference.name);
+            rule = (node_t *)node->data.reference.rule;
+            if (rule == NULL) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": No definition of rule '%s'\n",
+                    ctx->iname, (ulong_t)(node->data.reference.line + 1), (ulong_t)(node->data.reference.col + 1),
+                    node->data.reference.name);
+                ctx->errnum++;
+                continue;
+            }
+            if (ctx->flags & CODE_FLAG__AST) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Rule '%s' for %%eager not allowed with %%ast\n",
+                    ctx->iname, (ulong_t)(node->data.reference.line + 1), (ulong_t)(node->data.reference.col + 1), rule->data.rule.name);
+                ctx->errnum++;
+                continue;
+            }
+            if (is_left_recursive_rule(rule)) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Left-recursive rule '%s' not allowed for %%eager\n",
+                    ctx->iname, (ulong_t)(rule->data.rule.line + 1), (ulong_t)(rule->data.rule.col + 1), rule->data.rule.name);
+                ctx->errnum++;
+                continue;
+            }
+            for (j = 0; j < ctx->rules.len; j++) {
+                if (is_rule_reachable_in_predicate(ctx->rules.buf[j], rule)) break;
+            }
+            if (j < ctx->rules.len) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Rule '%s' for %%eager referred to in predicate in rule '%s'\n",
+                    ctx->iname, (ulong_t)(rule->data.rule.line + 1), (ulong_t)(rule->data.rule.col + 1), rule->data.rule.name,
+                    ctx->rules.buf[j]->data.rule.name);
+                ctx->errnum++;
+                continue;
+            }
+            for (j = 0; j < ctx->rules.len; j++) {
+                if (is_rule_reachable_in_backtracking(ctx->rules.buf[j], rule)) break;
+            }
+            if (j < ctx->rules.len) {
+                print_error("%s:" FMT_LU ":" FMT_LU ": Rule '%s' for %%eager possibly backtracked over in rule '%s'\n",
+                    ctx->iname, (ulong_t)(rule->data.rule.line + 1), (ulong_t)(rule->data.rule.col + 1), rule->data.rule.name,
+                    ctx->rules.buf[j]->data.rule.name);
+                ctx->errnum++;
+                continue;
+            }
+            rule->data.rule.attrs |= RULE_ATTR__EAGER;
+        }
+    }
     if (ctx->opts.debug) {
         size_t i;
         for (i = 0; i < ctx->rules.len; i++) {
@@ -2614,6 +4300,48 @@ static bool_t parse(context_t *ctx) {
     return (ctx->errnum == 0) ? TRUE : FALSE;
 }
 
+static bool_t optimize(context_t *ctx) {
+    static const optimizer_pass_t passes[] = {
+        { "predicate-simplification", 1, simplify_predicate },
+        { "quantifier-simplification", 1, simplify_quantifier },
+        { "string-concatenation", 1, concatenate_strings },
+        { "unreachable-alternative-elimination", 1, eliminate_unreachable_alternatives },
+        { "redundant-capture-removal", 3, remove_redundant_capture },
+        { "left-factoring", 1, factor_alternatives },
+        { "charclass-merging", 2, merge_charclasses }
+    };
+    size_t i, j;
+    for (j = 0; j < sizeof(passes) / sizeof(passes[0]); j++) {
+        if (ctx->opts.level < passes[j].level) continue;
+        for (i = 0; i < ctx->rules.len; i++) {
+            node_t *const rule = ctx->rules.buf[i];
+            bool_t b = FALSE;
+            rule->data.rule.expr = rewrite_nodes(ctx, rule, rule->data.rule.expr, passes[j].func, &b);
+            if (b && ctx->opts.debug) {
+                fprintf(stdout, "Pass '%s' transformed rule '%s':\n", passes[j].name, rule->data.rule.name);
+                dump_node(ctx, rule, 0);
+            }
+        }
+    }
+    if (
+        ctx->opts.level >= 2 && !(ctx->flags & (CODE_FLAG__EVENT | CODE_FLAG__AST)) &&
+        !is_text_in_code_blocks(&ctx->esource, "PCC_DEBUG") && !is_text_in_code_blocks(&ctx->eheader, "PCC_DEBUG") &&
+        !is_text_in_code_blocks(&ctx->source, "PCC_DEBUG") && !is_text_in_code_blocks(&ctx->header, "PCC_DEBUG")
+    ) { /* not to lose the debug events, the events for %event, or the nodes for %ast of the rules inlined automatically */
+        node_const_array_t a;
+        node_const_array__init(&a);
+        for (i = 0; i < ctx->rules.len; i++) {
+            decide_inlining(ctx->rules.buf[i], &a);
+        }
+        for (i = 0; i < ctx->rules.len; i++) {
+            limit_inlining_growth(ctx->rules.buf[i]);
+        }
+        node_const_array__term(&a);
+    }
+    if (!(ctx->flags & (CODE_FLAG__EVENT | CODE_FLAG__AST))) mark_thunkless_rules(ctx); /* every rule delivers the events for %event and %ast */
+    return TRUE;
+}
+
 static code_reach_t generate_matching_string_code(generate_t *gen, const char *value, int onfail, size_t indent, bool_t bare) {
     const size_t n = (value != NULL) ? strlen(value) : 0;
     if (n > 0) {
@@ -2657,7 +4385,7 @@ static code_reach_t generate_matching_string_code(generate_t *gen, const char *v
 }
 
 static code_reach_t generate_matching_charclass_code(generate_t *gen, const char *value, int onfail, size_t indent, bool_t bare) {
-    assert(gen->ascii);
+    assert(gen->ascii || (value != NULL && value[0] != '^' && is_ascii_string(value)));
     if (value != NULL) {
         const size_t n = strlen(value);
         if (n > 0) {
@@ -2760,11 +4488,64 @@ static code_reach_t generate_matching_utf8_charclass_code(generate_t *gen, const
     if (value == NULL || n > 0) {
         const bool_t a = (n > 0 && value[0] == '^') ? TRUE : FALSE;
         size_t i = a ? 1 : 0;
+        if (value != NULL && !a && is_ascii_string(value)) { /* bytes with the high bit set never match */
+            return generate_matching_charclass_code(gen, value, onfail, indent, bare);
+        }
         if (!bare) {
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "{\n");
             indent += 4;
         }
+        if (value == NULL || is_ascii_string(value)) { /* '.' or negated ASCII-only class: UTF-8 is decoded only for non-ASCII characters */
+            char s[5], t[5];
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "char c;\n");
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__printf(gen->stream, "if (pcc_refill_buffer(ctx, 1) < 1) goto L%04d;\n", onfail);
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "c = ctx->buffer.buf[ctx->cur];\n");
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "if ((unsigned char)c >= 0x80) {\n");
+            stream__write_characters(gen->stream, ' ', indent + 4);
+            stream__puts(gen->stream, "const size_t n = pcc_get_char_as_utf32(ctx, NULL);\n");
+            stream__write_characters(gen->stream, ' ', indent + 4);
+            stream__printf(gen->stream, "if (n == 0) goto L%04d;\n", onfail);
+            stream__write_characters(gen->stream, ' ', indent + 4);
+            stream__puts(gen->stream, "ctx->cur += n;\n");
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "}\n");
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "else {\n");
+            if (i < n) {
+                stream__write_characters(gen->stream, ' ', indent + 4);
+                stream__puts(gen->stream, "if (\n");
+                for (; i < n; i++) {
+                    stream__write_characters(gen->stream, ' ', indent + 8);
+                    if (value[i] == '\\' && i + 1 < n) i++;
+                    if (i + 2 < n && value[i + 1] == '-') {
+                        stream__printf(gen->stream, "(c >= '%s' && c <= '%s')%s\n",
+                            escape_character(value[i], &s), escape_character(value[i + 2], &t), (i + 3 == n) ? "" : " ||");
+                        i += 2;
+                    }
+                    else {
+                        stream__printf(gen->stream, "c == '%s'%s\n",
+                            escape_character(value[i], &s), (i + 1 == n) ? "" : " ||");
+                    }
+                }
+                stream__write_characters(gen->stream, ' ', indent + 4);
+                stream__printf(gen->stream, ") goto L%04d;\n", onfail);
+            }
+            stream__write_characters(gen->stream, ' ', indent + 4);
+            stream__puts(gen->stream, "ctx->cur++;\n");
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "}\n");
+            if (!bare) {
+                indent -= 4;
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "}\n");
+            }
+            return CODE_REACH__BOTH;
+        }
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "int u;\n");
         stream__write_characters(gen->stream, ' ', indent);
@@ -2823,6 +4604,26 @@ static code_reach_t generate_matching_utf8_charclass_code(generate_t *gen, const
 
 static code_reach_t generate_code(generate_t *gen, const node_t *node, int onfail, size_t indent, bool_t bare);
 
+static void insert_backtracking_variables(generate_t *gen, size_t pos, size_t indent, bool_t cur, bool_t thunks) {
+    /* declares the variables to backtrack at the position after the code using them is generated */
+    stream_t s;
+    stream__init(&s, NULL, VOID_VALUE);
+    if (cur) {
+        stream__write_characters(&s, ' ', indent);
+        stream__puts(&s, "const size_t p = ctx->cur;\n");
+    }
+    if (thunks && gen->chunk) {
+        stream__write_characters(&s, ' ', indent);
+        stream__puts(&s, "const size_t n = chunk->thunks.len;\n");
+    }
+    if (thunks && gen->event) {
+        stream__write_characters(&s, ' ', indent);
+        stream__puts(&s, "const size_t e = ctx->events.base + ctx->events.pending.len;\n");
+    }
+    stream__insert(gen->stream, pos, &s);
+    stream__term(&s);
+}
+
 static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *expr, int min, int max, int onfail, size_t indent, bool_t bare) {
     if (max > 1 || max < 0) {
         code_reach_t r;
@@ -2834,8 +4635,14 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
         if (min > 0) {
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "const size_t p0 = ctx->cur;\n");
-            stream__write_characters(gen->stream, ' ', indent);
-            stream__puts(gen->stream, "const size_t n0 = chunk->thunks.len;\n");
+            if (gen->chunk) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "const size_t n0 = chunk->thunks.len;\n");
+            }
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "const size_t e0 = ctx->events.base + ctx->events.pending.len;\n");
+            }
         }
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "int i;\n");
@@ -2844,13 +4651,11 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
             stream__puts(gen->stream, "for (i = 0;; i++) {\n");
         else
             stream__printf(gen->stream, "for (i = 0; i < %d; i++) {\n", max);
-        stream__write_characters(gen->stream, ' ', indent + 4);
-        stream__puts(gen->stream, "const size_t p = ctx->cur;\n");
-        stream__write_characters(gen->stream, ' ', indent + 4);
-        stream__puts(gen->stream, "const size_t n = chunk->thunks.len;\n");
         {
+            const size_t o = gen->stream->text.len;
             const int l = ++gen->label;
             r = generate_code(gen, expr, l, indent + 4, FALSE);
+            insert_backtracking_variables(gen, o, indent + 4, TRUE, (r != CODE_REACH__ALWAYS_SUCCEED) ? TRUE : FALSE);
             stream__write_characters(gen->stream, ' ', indent + 4);
             stream__puts(gen->stream, "if (ctx->cur == p) break;\n");
             if (r != CODE_REACH__ALWAYS_SUCCEED) {
@@ -2860,8 +4665,14 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
                 stream__printf(gen->stream, "L%04d:;\n", l);
                 stream__write_characters(gen->stream, ' ', indent + 4);
                 stream__puts(gen->stream, "ctx->cur = p;\n");
-                stream__write_characters(gen->stream, ' ', indent + 4);
-                stream__puts(gen->stream, "pcc_thunk_array__revert(ctx->auxil, &chunk->thunks, n);\n");
+                if (gen->chunk) {
+                    stream__write_characters(gen->stream, ' ', indent + 4);
+                    stream__puts(gen->stream, "pcc_thunk_array__revert(ctx, &chunk->thunks, n);\n");
+                }
+                if (gen->event) {
+                    stream__write_characters(gen->stream, ' ', indent + 4);
+                    stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+                }
                 stream__write_characters(gen->stream, ' ', indent + 4);
                 stream__puts(gen->stream, "break;\n");
             }
@@ -2873,8 +4684,14 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
             stream__printf(gen->stream, "if (i < %d) {\n", min);
             stream__write_characters(gen->stream, ' ', indent + 4);
             stream__puts(gen->stream, "ctx->cur = p0;\n");
-            stream__write_characters(gen->stream, ' ', indent + 4);
-            stream__puts(gen->stream, "pcc_thunk_array__revert(ctx->auxil, &chunk->thunks, n0);\n");
+            if (gen->chunk) {
+                stream__write_characters(gen->stream, ' ', indent + 4);
+                stream__puts(gen->stream, "pcc_thunk_array__revert(ctx, &chunk->thunks, n0);\n");
+            }
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent + 4);
+                stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e0);\n");
+            }
             stream__write_characters(gen->stream, ' ', indent + 4);
             stream__printf(gen->stream, "goto L%04d;\n", onfail);
             stream__write_characters(gen->stream, ' ', indent);
@@ -2897,11 +4714,8 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
                 stream__puts(gen->stream, "{\n");
                 indent += 4;
             }
-            stream__write_characters(gen->stream, ' ', indent);
-            stream__puts(gen->stream, "const size_t p = ctx->cur;\n");
-            stream__write_characters(gen->stream, ' ', indent);
-            stream__puts(gen->stream, "const size_t n = chunk->thunks.len;\n");
             {
+                const size_t o = gen->stream->text.len;
                 const int l = ++gen->label;
                 if (generate_code(gen, expr, l, indent, FALSE) != CODE_REACH__ALWAYS_SUCCEED) {
                     const int m = ++gen->label;
@@ -2911,10 +4725,17 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
                     stream__printf(gen->stream, "L%04d:;\n", l);
                     stream__write_characters(gen->stream, ' ', indent);
                     stream__puts(gen->stream, "ctx->cur = p;\n");
-                    stream__write_characters(gen->stream, ' ', indent);
-                    stream__puts(gen->stream, "pcc_thunk_array__revert(ctx->auxil, &chunk->thunks, n);\n");
+                    if (gen->chunk) {
+                        stream__write_characters(gen->stream, ' ', indent);
+                        stream__puts(gen->stream, "pcc_thunk_array__revert(ctx, &chunk->thunks, n);\n");
+                    }
+                    if (gen->event) {
+                        stream__write_characters(gen->stream, ' ', indent);
+                        stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+                    }
                     if (indent > 4) stream__write_characters(gen->stream, ' ', indent - 4);
                     stream__printf(gen->stream, "L%04d:;\n", m);
+                    insert_backtracking_variables(gen, o, indent, TRUE, TRUE);
                 }
             }
             if (!bare) {
@@ -2933,6 +4754,14 @@ static code_reach_t generate_quantifying_code(generate_t *gen, const node_t *exp
 
 static code_reach_t generate_predicating_code(generate_t *gen, const node_t *expr, bool_t neg, int onfail, size_t indent, bool_t bare) {
     code_reach_t r;
+    if (expr->type == NODE_CHARCLASS && expr->data.charclass.value == NULL) { /* !. or &. only peeks at the next character */
+        stream__write_characters(gen->stream, ' ', indent);
+        if (gen->ascii)
+            stream__printf(gen->stream, neg ? "if (pcc_refill_buffer(ctx, 1) >= 1) goto L%04d;\n" : "if (pcc_refill_buffer(ctx, 1) < 1) goto L%04d;\n", onfail);
+        else
+            stream__printf(gen->stream, neg ? "if (pcc_get_char_as_utf32(ctx, NULL) > 0) goto L%04d;\n" : "if (pcc_get_char_as_utf32(ctx, NULL) == 0) goto L%04d;\n", onfail);
+        return CODE_REACH__BOTH;
+    }
     if (!bare) {
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "{\n");
@@ -2940,12 +4769,20 @@ static code_reach_t generate_predicating_code(generate_t *gen, const node_t *exp
     }
     stream__write_characters(gen->stream, ' ', indent);
     stream__puts(gen->stream, "const size_t p = ctx->cur;\n");
+    if (gen->event) {
+        stream__write_characters(gen->stream, ' ', indent);
+        stream__puts(gen->stream, "const size_t e = ctx->events.base + ctx->events.pending.len;\n");
+    }
     if (neg) {
         const int l = ++gen->label;
         r = generate_code(gen, expr, l, indent, FALSE);
         if (r != CODE_REACH__ALWAYS_FAIL) {
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "ctx->cur = p;\n");
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+            }
             stream__write_characters(gen->stream, ' ', indent);
             stream__printf(gen->stream, "goto L%04d;\n", onfail);
         }
@@ -2954,6 +4791,10 @@ static code_reach_t generate_predicating_code(generate_t *gen, const node_t *exp
             stream__printf(gen->stream, "L%04d:;\n", l);
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "ctx->cur = p;\n");
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+            }
         }
         switch (r) {
         case CODE_REACH__ALWAYS_SUCCEED: r = CODE_REACH__ALWAYS_FAIL; break;
@@ -2968,6 +4809,10 @@ static code_reach_t generate_predicating_code(generate_t *gen, const node_t *exp
         if (r != CODE_REACH__ALWAYS_FAIL) {
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "ctx->cur = p;\n");
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+            }
         }
         if (r == CODE_REACH__BOTH) {
             stream__write_characters(gen->stream, ' ', indent);
@@ -2978,6 +4823,10 @@ static code_reach_t generate_predicating_code(generate_t *gen, const node_t *exp
             stream__printf(gen->stream, "L%04d:;\n", l);
             stream__write_characters(gen->stream, ' ', indent);
             stream__puts(gen->stream, "ctx->cur = p;\n");
+            if (gen->event) {
+                stream__write_characters(gen->stream, ' ', indent);
+                stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+            }
             stream__write_characters(gen->stream, ' ', indent);
             stream__printf(gen->stream, "goto L%04d;\n", onfail);
         }
@@ -3017,16 +4866,13 @@ static code_reach_t generate_sequential_code(generate_t *gen, const node_array_t
 static code_reach_t generate_alternative_code(generate_t *gen, const node_array_t *nodes, int onfail, size_t indent, bool_t bare) {
     bool_t b = FALSE;
     int m = ++gen->label;
-    size_t i;
+    size_t i, o;
     if (!bare) {
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "{\n");
         indent += 4;
     }
-    stream__write_characters(gen->stream, ' ', indent);
-    stream__puts(gen->stream, "const size_t p = ctx->cur;\n");
-    stream__write_characters(gen->stream, ' ', indent);
-    stream__puts(gen->stream, "const size_t n = chunk->thunks.len;\n");
+    o = gen->stream->text.len;
     for (i = 0; i < nodes->len; i++) {
         const bool_t c = (i + 1 < nodes->len) ? TRUE : FALSE;
         const int l = ++gen->label;
@@ -3040,6 +4886,7 @@ static code_reach_t generate_alternative_code(generate_t *gen, const node_array_
                 if (indent > 4) stream__write_characters(gen->stream, ' ', indent - 4);
                 stream__printf(gen->stream, "L%04d:;\n", m);
             }
+            if (i > 0) insert_backtracking_variables(gen, o, indent, TRUE, TRUE);
             if (!bare) {
                 indent -= 4;
                 stream__write_characters(gen->stream, ' ', indent);
@@ -3057,8 +4904,14 @@ static code_reach_t generate_alternative_code(generate_t *gen, const node_array_
         stream__printf(gen->stream, "L%04d:;\n", l);
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "ctx->cur = p;\n");
-        stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "pcc_thunk_array__revert(ctx->auxil, &chunk->thunks, n);\n");
+        if (gen->chunk) {
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "pcc_thunk_array__revert(ctx, &chunk->thunks, n);\n");
+        }
+        if (gen->event) {
+            stream__write_characters(gen->stream, ' ', indent);
+            stream__puts(gen->stream, "pcc_event_log__revert(ctx, &ctx->events, e);\n");
+        }
         if (!c) {
             stream__write_characters(gen->stream, ' ', indent);
             stream__printf(gen->stream, "goto L%04d;\n", onfail);
@@ -3068,6 +4921,7 @@ static code_reach_t generate_alternative_code(generate_t *gen, const node_array_
         if (indent > 4) stream__write_characters(gen->stream, ' ', indent - 4);
         stream__printf(gen->stream, "L%04d:;\n", m);
     }
+    if (nodes->len > 0) insert_backtracking_variables(gen, o, indent, TRUE, TRUE);
     if (!bare) {
         indent -= 4;
         stream__write_characters(gen->stream, ' ', indent);
@@ -3091,9 +4945,15 @@ static code_reach_t generate_capturing_code(generate_t *gen, const node_t *expr,
     stream__write_characters(gen->stream, ' ', indent);
     stream__puts(gen->stream, "q = ctx->cur;\n");
     stream__write_characters(gen->stream, ' ', indent);
-    stream__printf(gen->stream, "chunk->capts.buf[" FMT_LU "].range.start = p;\n", (ulong_t)index);
+    stream__printf(gen->stream, "chunk->capts[" FMT_LU "].range.start = p;\n", (ulong_t)index);
     stream__write_characters(gen->stream, ' ', indent);
-    stream__printf(gen->stream, "chunk->capts.buf[" FMT_LU "].range.end = q;\n", (ulong_t)index);
+    stream__printf(gen->stream, "chunk->capts[" FMT_LU "].range.end = q;\n", (ulong_t)index);
+    if (gen->event) {
+        assert(gen->chunk);
+        stream__write_characters(gen->stream, ' ', indent);
+        stream__printf(gen->stream, "pcc_event_log__add(ctx, &ctx->events, pcc_event_token_%s_" FMT_LU ", p, q);\n",
+            gen->rule->data.rule.name, (ulong_t)index);
+    }
     if (!bare) {
         indent -= 4;
         stream__write_characters(gen->stream, ' ', indent);
@@ -3110,7 +4970,7 @@ static code_reach_t generate_expanding_code(generate_t *gen, size_t index, int o
     }
     stream__write_characters(gen->stream, ' ', indent);
     stream__printf(gen->stream,
-        "const size_t n = chunk->capts.buf[" FMT_LU "].range.end - chunk->capts.buf[" FMT_LU "].range.start;\n", (ulong_t)index, (ulong_t)index);
+        "const size_t n = chunk->capts[" FMT_LU "].range.end - chunk->capts[" FMT_LU "].range.start;\n", (ulong_t)index, (ulong_t)index);
     stream__write_characters(gen->stream, ' ', indent);
     stream__printf(gen->stream, "if (pcc_refill_buffer(ctx, n) < n) goto L%04d;\n", onfail);
     stream__write_characters(gen->stream, ' ', indent);
@@ -3118,7 +4978,7 @@ static code_reach_t generate_expanding_code(generate_t *gen, size_t index, int o
     stream__write_characters(gen->stream, ' ', indent + 4);
     stream__puts(gen->stream, "const char *const p = ctx->buffer.buf + ctx->cur;\n");
     stream__write_characters(gen->stream, ' ', indent + 4);
-    stream__printf(gen->stream, "const char *const q = ctx->buffer.buf + chunk->capts.buf[" FMT_LU "].range.start;\n", (ulong_t)index);
+    stream__printf(gen->stream, "const char *const q = ctx->buffer.buf + chunk->capts[" FMT_LU "].range.start;\n", (ulong_t)index);
     stream__write_characters(gen->stream, ' ', indent + 4);
     stream__puts(gen->stream, "size_t i;\n");
     stream__write_characters(gen->stream, ' ', indent + 4);
@@ -3151,40 +5011,32 @@ static code_reach_t generate_thunking_action_code(
     if (error) {
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "pcc_value_t null;\n");
-    }
-    stream__write_characters(gen->stream, ' ', indent);
-    stream__printf(gen->stream, "pcc_thunk_t *const thunk = pcc_thunk__create_leaf(ctx->auxil, pcc_action_%s_" FMT_LU ", " FMT_LU ", " FMT_LU ");\n",
-        gen->rule->data.rule.name, (ulong_t)index, (ulong_t)gen->rule->data.rule.vars.len, (ulong_t)gen->rule->data.rule.capts.len);
-    {
-        size_t i;
-        for (i = 0; i < vars->len; i++) {
-            assert(vars->buf[i]->type == NODE_REFERENCE);
-            stream__write_characters(gen->stream, ' ', indent);
-            stream__printf(gen->stream, "thunk->data.leaf.values.buf[" FMT_LU "] = &(chunk->values.buf[" FMT_LU "]);\n",
-                (ulong_t)vars->buf[i]->data.reference.index, (ulong_t)vars->buf[i]->data.reference.index);
-        }
-        for (i = 0; i < capts->len; i++) {
-            assert(capts->buf[i]->type == NODE_CAPTURE);
-            stream__write_characters(gen->stream, ' ', indent);
-            stream__printf(gen->stream, "thunk->data.leaf.capts.buf[" FMT_LU "] = &(chunk->capts.buf[" FMT_LU "]);\n",
-                (ulong_t)capts->buf[i]->data.capture.index, (ulong_t)capts->buf[i]->data.capture.index);
-        }
         stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "thunk->data.leaf.capt0.range.start = chunk->pos;\n");
+        stream__puts(gen->stream, "pcc_thunk_t leaf;\n");
+        stream__write_characters(gen->stream, ' ', indent);
+        stream__printf(gen->stream, "pcc_thunk_t *const thunk = pcc_thunk__init_leaf(&leaf, pcc_action_%s_" FMT_LU ", %s, %s);\n",
+            gen->rule->data.rule.name, (ulong_t)index,
+            (vars->len > 0) ? "chunk->values" : "NULL", (capts->len > 0) ? "chunk->capts" : "NULL");
+    }
+    else {
         stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "thunk->data.leaf.capt0.range.end = ctx->cur;\n");
+        stream__printf(gen->stream, "pcc_thunk_t *const thunk = pcc_thunk_array__add_leaf(ctx, &chunk->thunks, pcc_action_%s_" FMT_LU ", %s, %s);\n",
+            gen->rule->data.rule.name, (ulong_t)index,
+            (vars->len > 0) ? "chunk->values" : "NULL", (capts->len > 0) ? "chunk->capts" : "NULL");
     }
+    stream__write_characters(gen->stream, ' ', indent);
+    stream__puts(gen->stream, "thunk->data.leaf.capt0.range.start = chunk->pos;\n");
+    stream__write_characters(gen->stream, ' ', indent);
+    stream__puts(gen->stream, "thunk->data.leaf.capt0.range.end = ctx->cur;\n");
     if (error) {
         stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "memset(&null, 0, sizeof(pcc_value_t)); /* in case */\n");
+        stream__puts(gen->stream, "PCC_VALUE_INIT(ctx->auxil, &null);\n");
         stream__write_characters(gen->stream, ' ', indent);
         stream__puts(gen->stream, "thunk->data.leaf.action(ctx, thunk, &null);\n");
         stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "pcc_thunk__destroy(ctx->auxil, thunk);\n");
-    }
-    else {
+        stream__puts(gen->stream, "PCC_VALUE_DESTROY(ctx->auxil, &null);\n");
         stream__write_characters(gen->stream, ' ', indent);
-        stream__puts(gen->stream, "pcc_thunk_array__add(ctx->auxil, &chunk->thunks, thunk);\n");
+        stream__puts(gen->stream, "pcc_thunk__term(ctx, thunk);\n");
     }
     if (!bare) {
         indent -= 4;
@@ -3227,22 +5079,34 @@ static code_reach_t generate_thunking_error_code(
 static code_reach_t generate_code(generate_t *gen, const node_t *node, int onfail, size_t indent, bool_t bare) {
     if (node == NULL) {
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     }
     switch (node->type) {
     case NODE_RULE:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
     case NODE_REFERENCE:
-        if (node->data.reference.index != VOID_VALUE) {
+        if (node->data.reference.index == VOID_VALUE && (node->data.reference.rule->data.rule.attrs & RULE_ATTR__SKIP)) {
+            stream__write_characters(gen->stream, ' ', indent);
+            if (is_always_succeeding(node->data.reference.rule)) {
+                stream__printf(gen->stream, "pcc_skip_rule_%s(ctx);\n", node->data.reference.name);
+                return CODE_REACH__ALWAYS_SUCCEED;
+            }
+            stream__printf(gen->stream, "if (!pcc_skip_rule_%s(ctx)) goto L%04d;\n", node->data.reference.name, onfail);
+        }
+        else if (node->data.reference.index == VOID_VALUE && is_inlined_rule(node->data.reference.rule)) {
+            return generate_code(gen, node->data.reference.rule->data.rule.expr, onfail, indent, bare);
+        }
+        else if (node->data.reference.index != VOID_VALUE) {
+            assert(gen->chunk);
             stream__write_characters(gen->stream, ' ', indent);
-            stream__printf(gen->stream, "if (!pcc_apply_rule(ctx, pcc_evaluate_rule_%s, &chunk->thunks, &(chunk->values.buf[" FMT_LU "]))) goto L%04d;\n",
+            stream__printf(gen->stream, "if (!pcc_apply_rule(ctx, pcc_evaluate_rule_%s, &chunk->thunks, &(chunk->values[" FMT_LU "]))) goto L%04d;\n",
                 node->data.reference.name, (ulong_t)node->data.reference.index, onfail);
         }
         else {
             stream__write_characters(gen->stream, ' ', indent);
-            stream__printf(gen->stream, "if (!pcc_apply_rule(ctx, pcc_evaluate_rule_%s, &chunk->thunks, NULL)) goto L%04d;\n",
-                node->data.reference.name, onfail);
+            stream__printf(gen->stream, "if (!pcc_apply_rule(ctx, pcc_evaluate_rule_%s, %s, NULL)) goto L%04d;\n",
+                node->data.reference.name, gen->chunk ? "&chunk->thunks" : "NULL", onfail);
         }
         return CODE_REACH__BOTH;
     case NODE_STRING:
@@ -3273,89 +5137,342 @@ static code_reach_t generate_code(generate_t *gen, const node_t *node, int onfai
         );
     default:
         print_error("Internal error [%d]\n", __LINE__);
-        exit(-1);
+        exit_e(-1);
+    }
+}
+
+static size_t assign_chunk_layouts(context_t *ctx) { /* returns the number of the distinct thunk chunk layouts */
+    size_t i, j, n = 0;
+    for (i = 0; i < ctx->rules.len; i++) {
+        node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+        for (j = 0; j < i; j++) {
+            const node_rule_t *const s = &ctx->rules.buf[j]->data.rule;
+            if (s->vars.len == r->vars.len && s->capts.len == r->capts.len) break;
+        }
+        r->layout = (j < i) ? ctx->rules.buf[j]->data.rule.layout : n++;
+    }
+    return n;
+}
+
+static bool_t has_output_sink(void) { /* checks if the generated files are passed to the caller of the library */
+#ifdef PCC_LIBRARY
+    return (g_sink != NULL && g_sink->output != NULL) ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
+static void save_stream(stream_t *stream) {
+#ifdef PCC_LIBRARY
+    if (has_output_sink()) {
+        g_sink->output(g_sink->data, stream->name, (stream->text.len > 0) ? stream->text.buf : "", stream->text.len);
+        return;
+    }
+#endif
+    stream__save(stream);
+}
+
+static bool_t remove_generated_file(const char *name) { /* returns FALSE if no file generated by PackCC exists */
+    static const char m[] = "/* A packrat parser generated by PackCC ";
+    char b[sizeof(m)];
+    size_t n;
+    FILE *const f = fopen(name, "rb");
+    if (f == NULL) return FALSE;
+    n = fread(b, 1, sizeof(m) - 1, f);
+    fclose(f);
+    if (n != sizeof(m) - 1 || memcmp(b, m, n) != 0) return FALSE; /* not to remove the files written by the user */
+    unlink(name);
+    return TRUE;
+}
+
+static void remove_stale_parts(context_t *ctx, size_t parts) { /* removes the files left by a former generation with more source files */
+    size_t i;
+    if (has_output_sink()) return;
+    if (parts == 0) {
+        char *const q = replace_fileext(ctx->sname, "private.h");
+        remove_generated_file(q);
+        free(q);
+    }
+    for (i = parts; i < SPLIT_MAX; i++) {
+        char e[32];
+        char *q;
+        bool_t b;
+        snprintf(e, sizeof(e), FMT_LU ".c", (ulong_t)(i + 1));
+        q = replace_fileext(ctx->sname, e);
+        b = remove_generated_file(q);
+        free(q);
+        if (!b) break; /* the source files are numbered consecutively */
+    }
+}
+
+static stream_t *prepare_outputs(context_t *ctx, size_t parts) { /* returns the streams; the files are not written yet */
+    output_set_t *const o = &ctx->outputs;
+    const size_t k = (parts > 0) ? parts + 3 : 2; /* the index of the source file of the shared runtime if any */
+    const size_t n = (ctx->opts.runtime != NULL) ? k + 2 : k;
+    const size_t line = ctx->opts.lines ? 0 : VOID_VALUE;
+    size_t i;
+    release_outputs(o);
+    o->streams = (stream_t *)malloc_e(sizeof(stream_t) * n);
+    o->names = (char **)malloc_e(sizeof(char *) * n);
+    for (i = 0; i < n; i++) {
+        stream__init(&o->streams[i], NULL, line);
+        o->names[i] = NULL;
+    }
+    o->len = n;
+    o->streams[0].name = ctx->sname;
+    o->streams[1].name = ctx->hname;
+    if (parts > 0) {
+        o->names[2] = replace_fileext(ctx->sname, "private.h"); /* the private header shared by the source files */
+        o->streams[2].name = o->names[2];
+        o->pid = strdup_e(o->names[2]);
+        make_header_identifier(o->pid);
+        for (i = 0; i < parts; i++) {
+            char e[32];
+            snprintf(e, sizeof(e), FMT_LU ".c", (ulong_t)(i + 1));
+            o->names[i + 3] = replace_fileext(ctx->sname, e); /* the source file for the rules */
+            o->streams[i + 3].name = o->names[i + 3];
+        }
+    }
+    if (ctx->opts.runtime != NULL) {
+        o->names[k] = add_fileext(ctx->opts.runtime, "c");
+        o->streams[k].name = o->names[k];
+        o->names[k + 1] = add_fileext(ctx->opts.runtime, "h");
+        o->streams[k + 1].name = o->names[k + 1];
+    }
+    return o->streams;
+}
+
+static size_t assign_source_parts(context_t *ctx) { /* returns the number of the source files for the rules; 0 if not split */
+    const size_t n = ctx->opts.split;
+    size_t i, m = 0, t = 0;
+    if (n == 0) return 0;
+    for (i = 0; i < ctx->rules.len; i++) {
+        t += weigh_nodes(ctx->rules.buf[i], TRUE); /* the rough size of the code generated for the rule */
     }
+    for (i = 0; i < ctx->rules.len; i++) { /* divides the rules into the consecutive ones of almost the same total size */
+        const size_t w = weigh_nodes(ctx->rules.buf[i], TRUE);
+        const size_t k = (m * 2 + w) * n / (t * 2);
+        ctx->rules.buf[i]->data.rule.part = (k < n) ? k : n - 1;
+        m += w;
+    }
+    return n;
+}
+
+static size_t get_runtime_key(context_t *ctx) { /* returns the hash value of what the shared runtime is specialized by */
+    size_t h = hash_string(VERSION);
+    h = h * 31 + hash_string(get_value_type(ctx));
+    h = h * 31 + hash_string(get_auxil_type(ctx));
+    h = h * 31 + (size_t)(ctx->flags & (CODE_FLAG__EVENT | CODE_FLAG__AST | CODE_FLAG__INTERN | CODE_FLAG__ARENA | CODE_FLAG__STATS));
+    return h & 0x7fffffff; /* small enough for the preprocessor */
 }
 
 static bool_t generate(context_t *ctx) {
+    static const char *const sm = /* the members of the structure of the statistics */
+        "    size_t memos; /* the number of the memos kept */\n"
+        "    size_t memos_peak;\n"
+        "    size_t memo_hits; /* the number of the rule applications answered by the memos */\n"
+        "    size_t memo_misses; /* the number of the rule applications evaluating the rules */\n"
+        "    size_t lrtable_length; /* the number of the input positions covered by the memo table */\n"
+        "    size_t lrtable_offset; /* the number of the table slots released ahead of the covered positions */\n"
+        "    size_t thunks; /* the number of the thunks kept */\n"
+        "    size_t thunks_peak;\n"
+        "    size_t chunks; /* the number of the thunk chunks kept */\n"
+        "    size_t chunks_peak;\n"
+        "    size_t pool_bytes; /* the bytes of the memory pools for the thunk chunks and the memos */\n"
+        "    size_t buffer_capacity; /* the bytes of the text buffer */\n"
+        "    size_t memory_bytes; /* the bytes allocated for the memoization, the thunks, the buffer, the interned strings, the pending events, and the AST */\n"
+        "    size_t memory_peak_bytes;\n";
+    const size_t layouts = assign_chunk_layouts(ctx);
+    const size_t parts = assign_source_parts(ctx);
     const char *const vt = get_value_type(ctx);
     const char *const at = get_auxil_type(ctx);
     const bool_t vp = is_pointer_type(vt);
     const bool_t ap = is_pointer_type(at);
-    stream_t sstream = stream__wrap(fopen_wt_e(ctx->sname), ctx->sname, ctx->opts.lines ? 0 : VOID_VALUE);
-    stream_t hstream = stream__wrap(fopen_wt_e(ctx->hname), ctx->hname, ctx->opts.lines ? 0 : VOID_VALUE);
-    stream__printf(&sstream, "/* A packrat parser generated by PackCC %s */\n\n", VERSION);
-    stream__printf(&hstream, "/* A packrat parser generated by PackCC %s */\n\n", VERSION);
+    const char *const rt = ctx->opts.runtime; /* the base name of the shared runtime files (NULL if the runtime is embedded) */
+    const char *const rp = (rt != NULL) ? extract_filename(rt) : get_prefix(ctx); /* the prefix of the names exported by the runtime */
+    const char *const sc = (parts > 0 || rt != NULL) ? "" : "static "; /* the storage class of the runtime functions referred to across the source files */
+    const char *const gc = (parts > 0) ? "" : "static "; /* the storage class of the grammar functions referred to across the source files */
+    const char *const ac = (rt != NULL) ? "" : "static "; /* the storage class of the runtime functions called only by the API functions */
+    const char *const nl = (rt != NULL) ? /* the number of the thunk chunk layouts */
+        "ctx->hooks->layoutc" : "sizeof(ctx->thunk_chunk_recyclers) / sizeof(ctx->thunk_chunk_recyclers[0])";
+    stream_t *const sstream = prepare_outputs(ctx, parts);
+    stream_t *const hstream = sstream + 1;
+    stream_t *const pstream = (parts > 0) ? sstream + 2 : NULL; /* the private header shared by the source files */
+    stream_t *const rstreams = (parts > 0) ? sstream + 3 : NULL; /* the source files for the rules */
+    stream_t *const tstream = (rt != NULL) ? sstream + ctx->outputs.len - 2 : NULL; /* the source file of the shared runtime */
+    stream_t *const ustream = (rt != NULL) ? sstream + ctx->outputs.len - 1 : NULL; /* the header file of the shared runtime */
+    const char *const pname = (parts > 0) ? pstream->name : NULL;
+    const char *const pid = ctx->outputs.pid;
+    stream_t *const us = (parts > 0) ? pstream : sstream; /* the stream for the user codes and the macros shared by the source files */
+    stream_t *const ps = (rt != NULL) ? ustream : us; /* the stream for the definitions shared by the source files */
+    stream_t *const ts = (rt != NULL) ? tstream : sstream; /* the stream for the runtime functions */
+    stream_t *const cs = (rt != NULL) ? tstream : ps; /* the stream for the configuration macros of the runtime */
+    stream__printf(sstream, "/* A packrat parser generated by PackCC %s */\n\n", VERSION);
+    stream__printf(hstream, "/* A packrat parser generated by PackCC %s */\n\n", VERSION);
+    if (rt != NULL) {
+        char *const q = strdup_e(ustream->name);
+        make_header_identifier(q);
+        stream__printf(tstream, "/* A packrat parser runtime generated by PackCC %s */\n\n", VERSION);
+        stream__printf(
+            ustream,
+            "/* A packrat parser runtime generated by PackCC %s */\n"
+            "\n"
+            "#ifndef PCC_INCLUDED_%s\n"
+            "#define PCC_INCLUDED_%s\n"
+            "\n"
+            "#include <stddef.h> /* for size_t */\n"
+            "\n"
+            "/* pcc_context_t%s must be defined before including this file. */\n"
+            "\n",
+            VERSION, q, q,
+            (ctx->flags & CODE_FLAG__STATS) ? " and pcc_stats_t" : ""
+        );
+        free(q);
+    }
+    if (parts > 0) {
+        size_t i;
+        stream__printf(
+            pstream,
+            "/* A packrat parser generated by PackCC %s */\n"
+            "\n"
+            "#ifndef PCC_INCLUDED_%s\n"
+            "#define PCC_INCLUDED_%s\n"
+            "\n",
+            VERSION, pid, pid
+        );
+        for (i = 0; i < parts; i++) {
+            stream__printf(
+                &rstreams[i],
+                "/* A packrat parser generated by PackCC %s */\n"
+                "\n"
+                "#include \"%s\"\n"
+                "\n",
+                VERSION, pname
+            );
+        }
+    }
     {
         {
             size_t i;
             for (i = 0; i < ctx->eheader.len; i++) {
-                stream__write_code_block(&hstream, ctx->eheader.buf[i].text, ctx->eheader.buf[i].len, 0, ctx->iname, ctx->eheader.buf[i].line);
+                stream__write_code_block(hstream, ctx->eheader.buf[i].text, ctx->eheader.buf[i].len, 0, ctx->iname, ctx->eheader.buf[i].line);
             }
         }
-        if (ctx->eheader.len > 0) stream__puts(&hstream, "\n");
+        if (ctx->eheader.len > 0) stream__puts(hstream, "\n");
         stream__printf(
-            &hstream,
+            hstream,
             "#ifndef PCC_INCLUDED_%s\n"
             "#define PCC_INCLUDED_%s\n"
+            "\n"
+            "#include <stddef.h> /* for size_t */\n"
             "\n",
             ctx->hid, ctx->hid
         );
         {
             size_t i;
             for (i = 0; i < ctx->header.len; i++) {
-                stream__write_code_block(&hstream, ctx->header.buf[i].text, ctx->header.buf[i].len, 0, ctx->iname, ctx->header.buf[i].line);
+                stream__write_code_block(hstream, ctx->header.buf[i].text, ctx->header.buf[i].len, 0, ctx->iname, ctx->header.buf[i].line);
             }
         }
     }
     {
-        {
-            size_t i;
-            for (i = 0; i < ctx->esource.len; i++) {
-                stream__write_code_block(&sstream, ctx->esource.buf[i].text, ctx->esource.buf[i].len, 0, ctx->iname, ctx->esource.buf[i].line);
-            }
+        size_t i;
+        for (i = 0; i < ctx->esource.len; i++) {
+            stream__write_code_block(us, ctx->esource.buf[i].text, ctx->esource.buf[i].len, 0, ctx->iname, ctx->esource.buf[i].line);
+        }
+        if (ctx->esource.len > 0) stream__puts(us, "\n");
+        for (i = 0; i < ((rt != NULL) ? 2 : 1); i++) {
+            stream__puts(
+                (i == 0) ? us : tstream,
+                "#ifdef _MSC_VER\n"
+                "#undef _CRT_SECURE_NO_WARNINGS\n"
+                "#define _CRT_SECURE_NO_WARNINGS\n"
+                "#endif /* _MSC_VER */\n"
+                "#include <stdio.h>\n"
+                "#include <stdlib.h>\n"
+                "#include <string.h>\n"
+                "\n"
+                "#ifndef _MSC_VER\n"
+                "#if defined __GNUC__ && defined _WIN32 /* MinGW */\n"
+                "#ifndef PCC_USE_SYSTEM_STRNLEN\n"
+                "#define strnlen(str, maxlen) pcc_strnlen(str, maxlen)\n"
+                "static size_t pcc_strnlen(const char *str, size_t maxlen) {\n"
+                "    size_t i;\n"
+                "    for (i = 0; i < maxlen && str[i]; i++);\n"
+                "    return i;\n"
+                "}\n"
+                "#endif /* !PCC_USE_SYSTEM_STRNLEN */\n"
+                "#endif /* defined __GNUC__ && defined _WIN32 */\n"
+                "#endif /* !_MSC_VER */\n"
+                "\n"
+            );
         }
-        if (ctx->esource.len > 0) stream__puts(&sstream, "\n");
-        stream__puts(
-            &sstream,
-            "#ifdef _MSC_VER\n"
-            "#undef _CRT_SECURE_NO_WARNINGS\n"
-            "#define _CRT_SECURE_NO_WARNINGS\n"
-            "#endif /* _MSC_VER */\n"
-            "#include <stdio.h>\n"
-            "#include <stdlib.h>\n"
-            "#include <string.h>\n"
-            "\n"
-            "#ifndef _MSC_VER\n"
-            "#if defined __GNUC__ && defined _WIN32 /* MinGW */\n"
-            "#ifndef PCC_USE_SYSTEM_STRNLEN\n"
-            "#define strnlen(str, maxlen) pcc_strnlen(str, maxlen)\n"
-            "static size_t pcc_strnlen(const char *str, size_t maxlen) {\n"
-            "    size_t i;\n"
-            "    for (i = 0; i < maxlen && str[i]; i++);\n"
-            "    return i;\n"
-            "}\n"
-            "#endif /* !PCC_USE_SYSTEM_STRNLEN */\n"
-            "#endif /* defined __GNUC__ && defined _WIN32 */\n"
-            "#endif /* !_MSC_VER */\n"
-            "\n"
-        );
         stream__printf(
-            &sstream,
+            us,
             "#include \"%s\"\n"
             "\n",
             ctx->hname
         );
-        {
-            size_t i;
-            for (i = 0; i < ctx->source.len; i++) {
-                stream__write_code_block(&sstream, ctx->source.buf[i].text, ctx->source.buf[i].len, 0, ctx->iname, ctx->source.buf[i].line);
-            }
+        for (i = 0; i < ctx->source.len; i++) {
+            stream__write_code_block(us, ctx->source.buf[i].text, ctx->source.buf[i].len, 0, ctx->iname, ctx->source.buf[i].line);
         }
     }
     {
+        if (rt != NULL) {
+            if (strcmp(get_prefix(ctx), "pcc") != 0) {
+                stream__printf(
+                    us,
+                    "typedef %s_context_t pcc_context_t;\n"
+                    "\n",
+                    get_prefix(ctx)
+                );
+                if (ctx->flags & CODE_FLAG__STATS) {
+                    stream__printf(
+                        us,
+                        "typedef %s_stats_t pcc_stats_t;\n"
+                        "\n",
+                        get_prefix(ctx)
+                    );
+                }
+            }
+            stream__printf(
+                tstream,
+                "typedef struct %s_context_tag pcc_context_t;\n"
+                "\n",
+                rp
+            );
+            if (ctx->flags & CODE_FLAG__STATS) {
+                stream__printf(
+                    tstream,
+                    "typedef struct %s_stats_tag pcc_stats_t;\n"
+                    "\n",
+                    rp
+                );
+            }
+            stream__printf(
+                tstream,
+                "#include \"%s\"\n"
+                "\n",
+                extract_filename(ustream->name)
+            );
+            {
+                char *const q = strdup_e(rp);
+                make_header_identifier(q);
+                stream__printf(
+                    us,
+                    "#include \"%s\"\n"
+                    "\n"
+                    "#if PCC_KEY_%s != " FMT_LU "\n"
+                    "#error \"The runtime has been generated for another value type, auxiliary type, or directives\"\n"
+                    "#endif\n"
+                    "\n",
+                    ustream->name, q, (ulong_t)get_runtime_key(ctx)
+                );
+                free(q);
+            }
+        }
         stream__puts(
-            &sstream,
+            ps,
             "#if !defined __has_attribute || defined _MSC_VER\n"
             "#define __attribute__(x)\n"
             "#endif\n"
@@ -3366,6 +5483,9 @@ static bool_t generate(context_t *ctx) {
             "#define MARK_FUNC_AS_USED __attribute__((__unused__))\n"
             "#endif\n"
             "\n"
+        );
+        stream__puts(
+            cs,
             "#ifndef PCC_BUFFER_MIN_SIZE\n"
             "#define PCC_BUFFER_MIN_SIZE 256\n"
             "#endif /* !PCC_BUFFER_MIN_SIZE */\n"
@@ -3378,6 +5498,22 @@ static bool_t generate(context_t *ctx) {
             "#define PCC_POOL_MIN_SIZE 65536\n"
             "#endif /* !PCC_POOL_MIN_SIZE */\n"
             "\n"
+            "#ifndef PCC_RETAIN_MAX_SIZE\n"
+            "#define PCC_RETAIN_MAX_SIZE (~(size_t)0)\n"
+            "#endif /* !PCC_RETAIN_MAX_SIZE */\n"
+            "\n"
+        );
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__puts(
+                cs,
+                "#ifndef PCC_ARENA_MIN_SIZE\n"
+                "#define PCC_ARENA_MIN_SIZE 65536\n"
+                "#endif /* !PCC_ARENA_MIN_SIZE */\n"
+                "\n"
+            );
+        }
+        stream__puts(
+            ps,
             "#define PCC_DBG_EVALUATE 0\n"
             "#define PCC_DBG_MATCH    1\n"
             "#define PCC_DBG_NOMATCH  2\n"
@@ -3402,56 +5538,40 @@ static bool_t generate(context_t *ctx) {
             "\n"
         );
         stream__printf(
-            &sstream,
+            ps,
             "typedef %s%spcc_value_t;\n"
             "\n",
             vt, vp ? "" : " "
         );
         stream__printf(
-            &sstream,
+            ps,
             "typedef %s%spcc_auxil_t;\n"
             "\n",
             at, ap ? "" : " "
         );
-        if (strcmp(get_prefix(ctx), "pcc") != 0) {
+        if (rt == NULL && strcmp(get_prefix(ctx), "pcc") != 0) {
             stream__printf(
-                &sstream,
+                ps,
                 "typedef %s_context_t pcc_context_t;\n"
                 "\n",
                 get_prefix(ctx)
             );
+            if (ctx->flags & CODE_FLAG__STATS) {
+                stream__printf(
+                    ps,
+                    "typedef %s_stats_t pcc_stats_t;\n"
+                    "\n",
+                    get_prefix(ctx)
+                );
+            }
         }
         stream__puts(
-            &sstream,
-            "typedef struct pcc_value_table_tag {\n"
-            "    pcc_value_t *buf;\n"
-            "    size_t max;\n"
-            "    size_t len;\n"
-            "} pcc_value_table_t;\n"
-            "\n"
-            "typedef struct pcc_value_refer_table_tag {\n"
-            "    pcc_value_t **buf;\n"
-            "    size_t max;\n"
-            "    size_t len;\n"
-            "} pcc_value_refer_table_t;\n"
-            "\n"
+            ps,
             "typedef struct pcc_capture_tag {\n"
             "    pcc_range_t range;\n"
             "    char *string; /* mutable */\n"
             "} pcc_capture_t;\n"
             "\n"
-            "typedef struct pcc_capture_table_tag {\n"
-            "    pcc_capture_t *buf;\n"
-            "    size_t max;\n"
-            "    size_t len;\n"
-            "} pcc_capture_table_t;\n"
-            "\n"
-            "typedef struct pcc_capture_const_table_tag {\n"
-            "    const pcc_capture_t **buf;\n"
-            "    size_t max;\n"
-            "    size_t len;\n"
-            "} pcc_capture_const_table_t;\n"
-            "\n"
             "typedef struct pcc_thunk_tag pcc_thunk_t;\n"
             "typedef struct pcc_thunk_array_tag pcc_thunk_array_t;\n"
             "\n"
@@ -3459,22 +5579,23 @@ static bool_t generate(context_t *ctx) {
             "\n"
         );
         stream__puts(
-            &sstream,
+            ps,
             "typedef enum pcc_thunk_type_tag {\n"
             "    PCC_THUNK_LEAF,\n"
             "    PCC_THUNK_NODE\n"
             "} pcc_thunk_type_t;\n"
             "\n"
             "typedef struct pcc_thunk_leaf_tag {\n"
-            "    pcc_value_refer_table_t values;\n"
-            "    pcc_capture_const_table_t capts;\n"
+            "    pcc_value_t *values; /* just a reference */\n"
+            "    const pcc_capture_t *capts; /* just a reference */\n"
             "    pcc_capture_t capt0;\n"
             "    pcc_action_t action;\n"
             "} pcc_thunk_leaf_t;\n"
             "\n"
             "typedef struct pcc_thunk_node_tag {\n"
-            "    const pcc_thunk_array_t *thunks; /* just a reference */\n"
+            "    const pcc_thunk_array_t *thunks; /* just a reference; NULL if the value has been evaluated eagerly */\n"
             "    pcc_value_t *value; /* just a reference */\n"
+            "    pcc_value_t *source; /* just a reference; the value evaluated eagerly */\n"
             "} pcc_thunk_node_t;\n"
             "\n"
             "typedef union pcc_thunk_data_tag {\n"
@@ -3488,18 +5609,90 @@ static bool_t generate(context_t *ctx) {
             "};\n"
             "\n"
             "struct pcc_thunk_array_tag {\n"
-            "    pcc_thunk_t **buf;\n"
+            "    pcc_thunk_t *buf;\n"
             "    size_t max;\n"
             "    size_t len;\n"
             "};\n"
             "\n"
+            "typedef struct pcc_memory_recycler_tag pcc_memory_recycler_t;\n"
+            "\n"
+        );
+        if (ctx->flags & CODE_FLAG__EVENT) {
+            stream__puts(
+                ps,
+                "typedef struct pcc_event_array_tag pcc_event_array_t;\n"
+                "\n"
+                "typedef struct pcc_event_span_tag {\n"
+                "    const pcc_event_array_t *array; /* just a reference; NULL if no events are held */\n"
+                "    size_t start; /* the mark in the event log while the rule is being evaluated */\n"
+                "    size_t end;\n"
+                "    size_t serial; /* the serial number of the last event, which tells if the events are still held */\n"
+                "    size_t index; /* the index in the list of the chunks holding the events */\n"
+                "} pcc_event_span_t;\n"
+                "\n"
+            );
+        }
+        stream__printf(
+            ps,
             "typedef struct pcc_thunk_chunk_tag {\n"
-            "    pcc_value_table_t values;\n"
-            "    pcc_capture_table_t capts;\n"
+            "    pcc_value_t *values; /* the storage following the chunk */\n"
+            "    pcc_capture_t *capts; /* the storage following the values */\n"
+            "    size_t valuec;\n"
+            "    size_t captc;\n"
             "    pcc_thunk_array_t thunks;\n"
             "    size_t pos; /* the starting position in the character buffer */\n"
+            "    pcc_memory_recycler_t *recycler; /* just a reference */\n"
+            "    pcc_bool_t evaluated; /* TRUE if the thunks have been evaluated eagerly */\n"
+            "    pcc_value_t value; /* the value evaluated eagerly */\n"
+            "%s"
             "} pcc_thunk_chunk_t;\n"
             "\n"
+            "typedef union pcc_thunk_chunk_align_tag {\n"
+            "    pcc_thunk_chunk_t chunk;\n"
+            "    pcc_value_t value;\n"
+            "    pcc_capture_t capture;\n"
+            "} pcc_thunk_chunk_align_t;\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_span_t events; /* the events of the rule held for the memo */\n" : ""
+        );
+        if (ctx->flags & CODE_FLAG__EVENT) {
+            stream__puts(
+                ps,
+                "typedef struct pcc_event_tag pcc_event_t;\n"
+                "\n"
+                "typedef void (*pcc_event_handler_t)(pcc_context_t *, const pcc_event_t *);\n"
+                "\n"
+                "struct pcc_event_tag {\n"
+                "    pcc_event_handler_t handler;\n"
+                "    pcc_range_t range; /* the end is PCC_VOID_VALUE until the rule entered finishes matching */\n"
+                "    size_t serial;\n"
+                "};\n"
+                "\n"
+                "struct pcc_event_array_tag {\n"
+                "    pcc_event_t *buf;\n"
+                "    size_t max;\n"
+                "    size_t len;\n"
+                "};\n"
+                "\n"
+                "typedef struct pcc_thunk_chunk_list_tag {\n"
+                "    pcc_thunk_chunk_t **buf; /* the elements are NULL if the chunks have been destroyed */\n"
+                "    size_t max;\n"
+                "    size_t len;\n"
+                "} pcc_thunk_chunk_list_t;\n"
+                "\n"
+                "typedef struct pcc_event_log_tag {\n"
+                "    pcc_event_array_t pending; /* the events not committed yet, in the document order */\n"
+                "    pcc_event_array_t stash; /* the events of the memos backtracked over, replayed if the memos are used */\n"
+                "    pcc_thunk_chunk_list_t held; /* the chunks holding the pending events, in the order of completion */\n"
+                "    pcc_thunk_chunk_list_t stashed; /* the chunks holding the stashed events */\n"
+                "    size_t base; /* the number of the events committed, which the marks count from */\n"
+                "    size_t serial; /* the serial number of the next event */\n"
+                "} pcc_event_log_t;\n"
+                "\n"
+            );
+        }
+        stream__puts(
+            ps,
             "typedef struct pcc_lr_entry_tag pcc_lr_entry_t;\n"
             "\n"
             "typedef enum pcc_lr_answer_type_tag {\n"
@@ -3523,7 +5716,7 @@ static bool_t generate(context_t *ctx) {
             "\n"
         );
         stream__puts(
-            &sstream,
+            ps,
             "typedef pcc_thunk_chunk_t *(*pcc_rule_t)(pcc_context_t *);\n"
             "\n"
             "typedef struct pcc_rule_set_tag {\n"
@@ -3578,9 +5771,74 @@ static bool_t generate(context_t *ctx) {
             "    size_t len;\n"
             "} pcc_lr_stack_t;\n"
             "\n"
+            "typedef struct pcc_thunk_frame_tag {\n"
+            "    const pcc_thunk_array_t *thunks; /* just a reference */\n"
+            "    size_t index; /* the index of the next thunk to be evaluated */\n"
+            "    pcc_value_t *value; /* just a reference; NULL if the value is discarded */\n"
+            "    pcc_value_t scratch; /* the storage of the value discarded */\n"
+            "} pcc_thunk_frame_t;\n"
+            "\n"
+            "typedef struct pcc_thunk_stack_tag {\n"
+            "    pcc_thunk_frame_t *buf;\n"
+            "    size_t max;\n"
+            "    size_t len;\n"
+            "} pcc_thunk_stack_t;\n"
+            "\n"
         );
+        if (ctx->flags & CODE_FLAG__INTERN) {
+            stream__puts(
+                ps,
+                "typedef struct pcc_string_table_tag {\n"
+                "    char **buf; /* the open addressing hash table; NULL if empty */\n"
+                "    size_t max; /* zero or a power of 2 */\n"
+                "    size_t len;\n"
+                "} pcc_string_table_t;\n"
+                "\n"
+            );
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            stream__puts(
+                ps,
+                "typedef struct pcc_index_array_tag {\n"
+                "    size_t *buf;\n"
+                "    size_t max;\n"
+                "    size_t len;\n"
+                "} pcc_index_array_t;\n"
+                "\n"
+                "typedef struct pcc_ast_tag {\n"
+                "    int *rules; /* the rule IDs of the nodes */\n"
+                "    pcc_range_t *ranges; /* the input ranges of the nodes */\n"
+                "    size_t *firsts; /* the indices in the child array of the first children of the nodes */\n"
+                "    size_t *counts; /* the numbers of the children of the nodes */\n"
+            );
+            if (ctx->flags & CODE_FLAG__INTERN) {
+                stream__puts(
+                    ps,
+                    "    size_t *hashes; /* the hash values of the nodes */\n"
+                );
+            }
+            stream__puts(
+                ps,
+                "    size_t max;\n"
+                "    size_t len;\n"
+                "    pcc_index_array_t children; /* the child indices of each node are contiguous */\n"
+                "    pcc_index_array_t pending; /* the indices of the nodes whose parents are being built */\n"
+                "    pcc_index_array_t opens; /* the indices of the nodes being built */\n"
+            );
+            if (ctx->flags & CODE_FLAG__INTERN) {
+                stream__puts(
+                    ps,
+                    "    pcc_index_array_t slots; /* the open addressing hash table of the node indices to share identical subtrees */\n"
+                );
+            }
+            stream__puts(
+                ps,
+                "} pcc_ast_t;\n"
+                "\n"
+            );
+        }
         stream__puts(
-            &sstream,
+            ps,
             "typedef struct pcc_memory_entry_tag pcc_memory_entry_t;\n"
             "typedef struct pcc_memory_pool_tag pcc_memory_pool_t;\n"
             "\n"
@@ -3594,48 +5852,172 @@ static bool_t generate(context_t *ctx) {
             "    size_t unused;\n"
             "};\n"
             "\n"
-            "typedef struct pcc_memory_recycler_tag {\n"
+            "struct pcc_memory_recycler_tag {\n"
             "    pcc_memory_pool_t *pool_list;\n"
             "    pcc_memory_entry_t *entry_list;\n"
             "    size_t element_size;\n"
-            "} pcc_memory_recycler_t;\n"
+            "};\n"
+            "\n"
+            "typedef struct pcc_memory_budget_tag {\n"
+            "    size_t used; /* the bytes allocated for the recyclers, the LR table, the thunks, and the buffer */\n"
+            "    size_t limit; /* zero if unlimited */\n"
+            "    size_t margin; /* the usage above which the memos of the failed rules are no longer kept */\n"
+            "    pcc_bool_t saving;\n"
+            "} pcc_memory_budget_t;\n"
             "\n"
         );
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__puts(
+                ps,
+                "typedef union pcc_arena_align_tag {\n"
+                "    pcc_thunk_chunk_align_t chunk;\n"
+                "    void *pointer;\n"
+                "    double real;\n"
+                "    long integer;\n"
+                "} pcc_arena_align_t;\n"
+                "\n"
+                "typedef struct pcc_arena_block_tag pcc_arena_block_t;\n"
+                "\n"
+                "struct pcc_arena_block_tag {\n"
+                "    pcc_arena_block_t *next;\n"
+                "    size_t size; /* the size of the storage following the block header */\n"
+                "    size_t used;\n"
+                "    pcc_bool_t region; /* TRUE if supplied by the caller */\n"
+                "};\n"
+                "\n"
+                "typedef struct pcc_arena_tag {\n"
+                "    pcc_arena_block_t *blocks; /* the block being used first */\n"
+                "} pcc_arena_t;\n"
+                "\n"
+            );
+        }
+        if (rt != NULL) {
+            if (ctx->flags & CODE_FLAG__STATS) {
+                char *const q = strdup_e(rp);
+                make_header_identifier(q);
+                stream__printf(
+                    ps,
+                    "#ifndef PCC_DEFINED_%s_STATS\n"
+                    "#define PCC_DEFINED_%s_STATS\n"
+                    "struct %s_stats_tag {\n"
+                    "%s"
+                    "};\n"
+                    "#endif /* !PCC_DEFINED_%s_STATS */\n"
+                    "\n",
+                    q, q, rp, sm, q
+                );
+                free(q);
+            }
+            stream__puts(
+                ps,
+                "typedef struct pcc_hooks_tag { /* the callbacks into the grammar */\n"
+                "    int (*get_char)(pcc_auxil_t auxil); /* PCC_GETCHAR() */\n"
+                "    int (*canceled)(pcc_auxil_t auxil); /* PCC_CANCELED() */\n"
+                "    void (*value_init)(pcc_auxil_t auxil, pcc_value_t *value); /* PCC_VALUE_INIT() */\n"
+                "    void (*value_move)(pcc_auxil_t auxil, pcc_value_t *dst, pcc_value_t *src); /* PCC_VALUE_MOVE() */\n"
+                "    void (*value_destroy)(pcc_auxil_t auxil, pcc_value_t *value); /* PCC_VALUE_DESTROY() */\n"
+                "    const size_t *layouts; /* the numbers of the values and the captures of the thunk chunk layouts, in pairs */\n"
+                "    size_t layoutc; /* the number of the thunk chunk layouts */\n"
+                "} pcc_hooks_t;\n"
+                "\n"
+            );
+        }
         stream__printf(
-            &sstream,
+            ps,
             "struct %s_context_tag {\n"
             "    size_t pos; /* the position in the input of the first character currently buffered */\n"
             "    size_t cur; /* the current parsing position in the character buffer */\n"
-            "    size_t level;\n"
+            "    size_t level; /* the number of the rules being evaluated in nesting */\n"
+            "    size_t depth_limit;\n"
+            "    int status; /* zero, or the error status which has stopped the parsing */\n"
+            "    size_t steps; /* the number of the rule applications since the context was created or reset */\n"
+            "    size_t step_limit;\n"
             "    pcc_char_array_t buffer;\n"
             "    pcc_lr_table_t lrtable;\n"
             "    pcc_lr_stack_t lrstack;\n"
+            "    pcc_thunk_stack_t thunkstack;\n"
             "    pcc_thunk_array_t thunks;\n"
-            "    pcc_auxil_t auxil;\n"
-            "    pcc_memory_recycler_t thunk_chunk_recycler;\n"
+            "    pcc_thunk_chunk_t void_chunk; /* shared by the rules that never produce thunks */\n"
+            "%s%s%s%s"
+            "    pcc_auxil_t auxil;\n",
+            rp,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log_t events; /* the events delivered at the next commit unless backtracked over */\n" : "",
+            (ctx->flags & CODE_FLAG__INTERN) ? "    pcc_string_table_t strings; /* the capture strings shared until the context is destroyed */\n" : "",
+            (ctx->flags & CODE_FLAG__AST) ? "    pcc_ast_t ast; /* the tree built by the last parsing */\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "    pcc_arena_t arena; /* the storage of the memory released at the end of every parsing */\n" : ""
+        );
+        if (rt != NULL) {
+            stream__puts(
+                ps,
+                "    const pcc_hooks_t *hooks;\n"
+                "    pcc_memory_recycler_t *thunk_chunk_recyclers; /* indexed by the thunk chunk layouts */\n"
+            );
+        }
+        else {
+            stream__printf(
+                ps,
+                "    pcc_memory_recycler_t thunk_chunk_recyclers[" FMT_LU "]; /* indexed by the thunk chunk layouts */\n",
+                (ulong_t)((layouts > 0) ? layouts : 1)
+            );
+        }
+        stream__printf(
+            ps,
             "    pcc_memory_recycler_t lr_head_recycler;\n"
             "    pcc_memory_recycler_t lr_answer_recycler;\n"
+            "    pcc_memory_budget_t budget;\n"
+            "%s"
             "};\n"
             "\n",
-            get_prefix(ctx)
+            (ctx->flags & CODE_FLAG__STATS) ? "    pcc_stats_t stats; /* the usage counted since the context was created or reset */\n" : ""
         );
+        if (rt != NULL) {
+            char *const q = strdup_e(rp);
+            make_header_identifier(q);
+            stream__printf(
+                ps,
+                "enum %s_status_tag { /* the same as the statuses of the parsers */\n"
+                "    %s_STATUS_MEMORY_LIMIT = -1,\n"
+                "    %s_STATUS_STEP_LIMIT = -2,\n"
+                "    %s_STATUS_CANCELED = -3,\n"
+                "    %s_STATUS_DEPTH_LIMIT = -4,\n"
+                "    %s_STATUS_SYNTAX_ERROR = -5\n"
+                "};\n"
+                "\n"
+                "#define PCC_KEY_%s " FMT_LU " /* identifies the types and the directives which the runtime is specialized by */\n"
+                "\n",
+                rp, q, q, q, q, q, q, (ulong_t)get_runtime_key(ctx)
+            );
+            free(q);
+        }
         stream__puts(
-            &sstream,
+            us,
             "#ifndef PCC_ERROR\n"
+            "#ifdef PCC_USE_ERROR_STATUS\n"
+            "#define PCC_ERROR(auxil) ((void)0)\n"
+            "#else /* !PCC_USE_ERROR_STATUS */\n"
             "#define PCC_ERROR(auxil) pcc_error()\n"
             "MARK_FUNC_AS_USED\n"
             "static void pcc_error(void) {\n"
             "    fprintf(stderr, \"Syntax error\\n\");\n"
             "    exit(1);\n"
             "}\n"
+            "#endif /* PCC_USE_ERROR_STATUS */\n"
             "#endif /* !PCC_ERROR */\n"
             "\n"
             "#ifndef PCC_GETCHAR\n"
             "#define PCC_GETCHAR(auxil) getchar()\n"
             "#endif /* !PCC_GETCHAR */\n"
             "\n"
+            "#ifndef PCC_CANCELED\n"
+            "#define PCC_CANCELED(auxil) 0\n"
+            "#endif /* !PCC_CANCELED */\n"
+            "\n"
+        );
+        stream__puts(
+            cs,
             "#ifndef PCC_MALLOC\n"
             "#define PCC_MALLOC(auxil, size) pcc_malloc_e(size)\n"
+            "MARK_FUNC_AS_USED\n"
             "static void *pcc_malloc_e(size_t size) {\n"
             "    void *const p = malloc(size);\n"
             "    if (p == NULL) {\n"
@@ -3648,6 +6030,7 @@ static bool_t generate(context_t *ctx) {
             "\n"
             "#ifndef PCC_REALLOC\n"
             "#define PCC_REALLOC(auxil, ptr, size) pcc_realloc_e(ptr, size)\n"
+            "MARK_FUNC_AS_USED\n"
             "static void *pcc_realloc_e(void *ptr, size_t size) {\n"
             "    void *const p = realloc(ptr, size);\n"
             "    if (p == NULL) {\n"
@@ -3662,10 +6045,41 @@ static bool_t generate(context_t *ctx) {
             "#define PCC_FREE(auxil, ptr) free(ptr)\n"
             "#endif /* !PCC_FREE */\n"
             "\n"
+        );
+        stream__puts(
+            us,
+            "#ifndef PCC_VALUE_INIT\n"
+            "#define PCC_VALUE_INIT(auxil, value) memset(value, 0, sizeof(pcc_value_t))\n"
+            "#endif /* !PCC_VALUE_INIT */\n"
+            "\n"
+            "#ifndef PCC_VALUE_MOVE\n"
+            "#define PCC_VALUE_MOVE(auxil, dst, src) (*(dst) = *(src))\n"
+            "#endif /* !PCC_VALUE_MOVE */\n"
+            "\n"
+            "#ifndef PCC_VALUE_DESTROY\n"
+            "#define PCC_VALUE_DESTROY(auxil, value) ((void)0)\n"
+            "#endif /* !PCC_VALUE_DESTROY */\n"
+            "\n"
             "#ifndef PCC_DEBUG\n"
             "#define PCC_DEBUG(auxil, event, rule, level, pos, buffer, length) ((void)0)\n"
             "#endif /* !PCC_DEBUG */\n"
             "\n"
+            "#ifndef PCC_ON_ENTER\n"
+            "#define PCC_ON_ENTER(auxil, rule, pos, buffer, length) ((void)0)\n"
+            "#endif /* !PCC_ON_ENTER */\n"
+            "\n"
+            "#ifndef PCC_ON_LEAVE\n"
+            "#define PCC_ON_LEAVE(auxil, rule, pos, buffer, length) ((void)0)\n"
+            "#endif /* !PCC_ON_LEAVE */\n"
+            "\n"
+            "#ifndef PCC_ON_TOKEN\n"
+            "#define PCC_ON_TOKEN(auxil, rule, index, pos, buffer, length) ((void)0)\n"
+            "#endif /* !PCC_ON_TOKEN */\n"
+            "\n"
+        );
+        stream__puts(
+            cs,
+            "MARK_FUNC_AS_USED\n"
             "static char *pcc_strndup_e(pcc_auxil_t auxil, const char *str, size_t len) {\n"
             "    const size_t m = strnlen(str, len);\n"
             "    char *const s = (char *)PCC_MALLOC(auxil, m + 1);\n"
@@ -3675,8 +6089,157 @@ static bool_t generate(context_t *ctx) {
             "}\n"
             "\n"
         );
+        if (rt != NULL) {
+            stream__puts(
+                tstream,
+                "/* the macros of the grammar are called through the callbacks */\n"
+                "#define PCC_GETCHAR(auxil) ctx->hooks->get_char(auxil)\n"
+                "#define PCC_CANCELED(auxil) ctx->hooks->canceled(auxil)\n"
+                "#define PCC_VALUE_INIT(auxil, value) ctx->hooks->value_init(auxil, value)\n"
+                "#define PCC_VALUE_MOVE(auxil, dst, src) ctx->hooks->value_move(auxil, dst, src)\n"
+                "#define PCC_VALUE_DESTROY(auxil, value) ctx->hooks->value_destroy(auxil, value)\n"
+                "\n"
+            );
+        }
+        if (parts > 0 || rt != NULL) {
+            static const char *const names[] = { /* the runtime functions referred to by the rule functions */
+                "thunk__init_leaf", "thunk__term", "thunk_array__add_leaf", "thunk_array__revert", "thunk_chunk__create", "thunk_chunk__destroy",
+                "event_log__open", "event_log__close", "event_log__add", "event_log__revert", "event_log__commit",
+                "ast__enter", "ast__leave", "refill_buffer", "get_capture_string", "get_char_as_utf32", "apply_rule", "do_action"
+            };
+            static const char *const anames[] = { /* the runtime functions referred to only by the API functions */
+                "arena__set_region", "ast__clear", "commit_buffer", "context__create", "context__destroy", "context__release",
+                "context__reset", "context__trim", "memory_recycler__size", "string_table__clear"
+            };
+            const char *const p = get_prefix(ctx);
+            size_t i, j;
+            for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+                stream__printf(ps, "#define pcc_%s %s__%s\n", names[i], rp, names[i]);
+            }
+            if (rt != NULL) {
+                for (i = 0; i < sizeof(anames) / sizeof(anames[0]); i++) {
+                    stream__printf(ps, "#define pcc_%s %s__%s\n", anames[i], rp, anames[i]);
+                }
+            }
+            for (i = 0; parts > 0 && i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                for (j = 0; j < r->codes.len; j++) {
+                    const size_t d = (r->codes.buf[j]->type == NODE_ACTION) ? r->codes.buf[j]->data.action.index : r->codes.buf[j]->data.error.index;
+                    stream__printf(pstream, "#define pcc_action_%s_" FMT_LU " %s__action_%s_" FMT_LU "\n", r->name, (ulong_t)d, p, r->name, (ulong_t)d);
+                }
+                if (ctx->flags & CODE_FLAG__AST) {
+                    stream__printf(pstream, "#define pcc_node_enter_%s %s__node_enter_%s\n", r->name, p, r->name);
+                    stream__printf(pstream, "#define pcc_node_leave_%s %s__node_leave_%s\n", r->name, p, r->name);
+                }
+                if (ctx->flags & CODE_FLAG__EVENT) {
+                    stream__printf(pstream, "#define pcc_event_enter_%s %s__event_enter_%s\n", r->name, p, r->name);
+                    stream__printf(pstream, "#define pcc_event_leave_%s %s__event_leave_%s\n", r->name, p, r->name);
+                    for (j = 0; j < r->capts.len; j++) {
+                        const size_t d = r->capts.buf[j]->data.capture.index;
+                        stream__printf(pstream, "#define pcc_event_token_%s_" FMT_LU " %s__event_token_%s_" FMT_LU "\n", r->name, (ulong_t)d, p, r->name, (ulong_t)d);
+                    }
+                }
+                if (r->attrs & RULE_ATTR__SKIP) {
+                    stream__printf(pstream, "#define pcc_skip_rule_%s %s__skip_rule_%s\n", r->name, p, r->name);
+                }
+                stream__printf(pstream, "#define pcc_evaluate_rule_%s %s__evaluate_rule_%s\n", r->name, p, r->name);
+            }
+            stream__printf(
+                ps,
+                "\n"
+                "pcc_thunk_t *pcc_thunk__init_leaf(pcc_thunk_t *thunk, pcc_action_t action, pcc_value_t *values, const pcc_capture_t *capts);\n"
+                "void pcc_thunk__term(pcc_context_t *ctx, pcc_thunk_t *thunk);\n"
+                "pcc_thunk_t *pcc_thunk_array__add_leaf(\n"
+                "    pcc_context_t *ctx, pcc_thunk_array_t *array, pcc_action_t action, pcc_value_t *values, const pcc_capture_t *capts\n"
+                ");\n"
+                "void pcc_thunk_array__revert(pcc_context_t *ctx, pcc_thunk_array_t *array, size_t len);\n"
+                "pcc_thunk_chunk_t *pcc_thunk_chunk__create(pcc_context_t *ctx, pcc_memory_recycler_t *recycler, size_t valuec, size_t captc);\n"
+                "void pcc_thunk_chunk__destroy(pcc_context_t *ctx, pcc_thunk_chunk_t *chunk);\n"
+                "%s%s"
+                "size_t pcc_refill_buffer(pcc_context_t *ctx, size_t num);\n"
+                "const char *pcc_get_capture_string(pcc_context_t *ctx, const pcc_capture_t *capt);\n"
+                "%s"
+                "pcc_bool_t pcc_apply_rule(pcc_context_t *ctx, pcc_rule_t rule, pcc_thunk_array_t *thunks, pcc_value_t *value);\n"
+                "void pcc_do_action(pcc_context_t *ctx, const pcc_thunk_array_t *thunks, pcc_value_t *value);\n"
+                "\n",
+                (ctx->flags & CODE_FLAG__EVENT) ?
+                    "void pcc_event_log__open(pcc_context_t *ctx, pcc_event_log_t *log, pcc_thunk_chunk_t *chunk, pcc_event_handler_t handler);\n"
+                    "void pcc_event_log__close(pcc_context_t *ctx, pcc_event_log_t *log, pcc_thunk_chunk_t *chunk, pcc_event_handler_t handler);\n"
+                    "void pcc_event_log__add(pcc_context_t *ctx, pcc_event_log_t *log, pcc_event_handler_t handler, size_t start, size_t end);\n"
+                    "void pcc_event_log__revert(pcc_context_t *ctx, pcc_event_log_t *log, size_t mark);\n"
+                    "void pcc_event_log__commit(pcc_context_t *ctx, pcc_event_log_t *log);\n" : "",
+                (ctx->flags & CODE_FLAG__AST) ?
+                    (ctx->flags & CODE_FLAG__INTERN) ?
+                        "void pcc_ast__enter(pcc_context_t *ctx, pcc_ast_t *ast, int rule, size_t start, size_t end);\n"
+                        "void pcc_ast__leave(pcc_context_t *ctx, pcc_ast_t *ast, const char *buffer, size_t pos);\n" :
+                        "void pcc_ast__enter(pcc_context_t *ctx, pcc_ast_t *ast, int rule, size_t start, size_t end);\n"
+                        "void pcc_ast__leave(pcc_context_t *ctx, pcc_ast_t *ast);\n" : "",
+                (rt != NULL || (ctx->flags & CODE_FLAG__UTF8_CHARCLASS_USED)) ? "size_t pcc_get_char_as_utf32(pcc_context_t *ctx, int *out);\n" : ""
+            );
+            if (rt != NULL) {
+                stream__printf(
+                    ps,
+                    "pcc_context_t *pcc_context__create(pcc_auxil_t auxil, const pcc_hooks_t *hooks);\n"
+                    "void pcc_context__destroy(pcc_context_t *ctx);\n"
+                    "%s"
+                    "void pcc_context__trim(pcc_context_t *ctx);\n"
+                    "void pcc_context__reset(pcc_context_t *ctx, pcc_auxil_t auxil);\n"
+                    "void pcc_commit_buffer(pcc_context_t *ctx);\n"
+                    "size_t pcc_memory_recycler__size(const pcc_context_t *ctx, const pcc_memory_recycler_t *recycler);\n"
+                    "%s%s%s"
+                    "\n",
+                    (ctx->flags & CODE_FLAG__ARENA) ? "void pcc_context__release(pcc_context_t *ctx);\n" : "",
+                    (ctx->flags & CODE_FLAG__ARENA) ? "void pcc_arena__set_region(pcc_auxil_t auxil, pcc_arena_t *arena, void *region, size_t size);\n" : "",
+                    (ctx->flags & CODE_FLAG__AST) ? "void pcc_ast__clear(pcc_auxil_t auxil, pcc_ast_t *ast);\n" : "",
+                    (ctx->flags & CODE_FLAG__INTERN) ? "void pcc_string_table__clear(pcc_context_t *ctx, pcc_string_table_t *table);\n" : ""
+                );
+                if (parts > 0) stream__puts(pstream, "\n");
+            }
+            for (i = 0; parts > 0 && i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                for (j = 0; j < r->codes.len; j++) {
+                    const size_t d = (r->codes.buf[j]->type == NODE_ACTION) ? r->codes.buf[j]->data.action.index : r->codes.buf[j]->data.error.index;
+                    stream__printf(
+                        pstream,
+                        "void pcc_action_%s_" FMT_LU "(%s_context_t *__pcc_ctx, pcc_thunk_t *__pcc_in, pcc_value_t *__pcc_out);\n",
+                        r->name, (ulong_t)d, p
+                    );
+                }
+                if (ctx->flags & CODE_FLAG__AST) {
+                    stream__printf(
+                        pstream,
+                        "void pcc_node_enter_%s(pcc_context_t *ctx, pcc_thunk_t *thunk, pcc_value_t *value);\n"
+                        "void pcc_node_leave_%s(pcc_context_t *ctx, pcc_thunk_t *thunk, pcc_value_t *value);\n",
+                        r->name, r->name
+                    );
+                }
+                if (ctx->flags & CODE_FLAG__EVENT) {
+                    stream__printf(
+                        pstream,
+                        "void pcc_event_enter_%s(pcc_context_t *ctx, const pcc_event_t *event);\n"
+                        "void pcc_event_leave_%s(pcc_context_t *ctx, const pcc_event_t *event);\n",
+                        r->name, r->name
+                    );
+                    for (j = 0; j < r->capts.len; j++) {
+                        stream__printf(
+                            pstream,
+                            "void pcc_event_token_%s_" FMT_LU "(pcc_context_t *ctx, const pcc_event_t *event);\n",
+                            r->name, (ulong_t)r->capts.buf[j]->data.capture.index
+                        );
+                    }
+                }
+            }
+            if (parts > 0) {
+                stream__printf(
+                    sstream,
+                    "#include \"%s\"\n"
+                    "\n",
+                    pname
+                );
+            }
+        }
         stream__puts(
-            &sstream,
+            ts,
             "static void pcc_char_array__init(pcc_auxil_t auxil, pcc_char_array_t *array) {\n"
             "    array->len = 0;\n"
             "    array->max = 0;\n"
@@ -3701,138 +6264,135 @@ static bool_t generate(context_t *ctx) {
             "}\n"
             "\n"
         );
-        stream__puts(
-            &sstream,
-            "static void pcc_value_table__init(pcc_auxil_t auxil, pcc_value_table_t *table) {\n"
-            "    table->len = 0;\n"
-            "    table->max = 0;\n"
-            "    table->buf = NULL;\n"
-            "}\n"
-            "\n"
-            "MARK_FUNC_AS_USED\n"
-            "static void pcc_value_table__resize(pcc_auxil_t auxil, pcc_value_table_t *table, size_t len) {\n"
-            "    if (table->max < len) {\n"
-            "        size_t m = table->max;\n"
-            "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
-            "        while (m < len && m != 0) m <<= 1;\n"
-            "        if (m == 0) m = len;\n"
-            "        table->buf = (pcc_value_t *)PCC_REALLOC(auxil, table->buf, sizeof(pcc_value_t) * m);\n"
-            "        table->max = m;\n"
-            "    }\n"
-            "    table->len = len;\n"
-            "}\n"
-            "\n"
-            "MARK_FUNC_AS_USED\n"
-            "static void pcc_value_table__clear(pcc_auxil_t auxil, pcc_value_table_t *table) {\n"
-            "    memset(table->buf, 0, sizeof(pcc_value_t) * table->len);\n"
-            "}\n"
-            "\n"
-            "static void pcc_value_table__term(pcc_auxil_t auxil, pcc_value_table_t *table) {\n"
-            "    PCC_FREE(auxil, table->buf);\n"
-            "}\n"
-            "\n"
-        );
-        stream__puts(
-            &sstream,
-            "static void pcc_value_refer_table__init(pcc_auxil_t auxil, pcc_value_refer_table_t *table) {\n"
-            "    table->len = 0;\n"
-            "    table->max = 0;\n"
-            "    table->buf = NULL;\n"
-            "}\n"
-            "\n"
-            "static void pcc_value_refer_table__resize(pcc_auxil_t auxil, pcc_value_refer_table_t *table, size_t len) {\n"
-            "    size_t i;\n"
-            "    if (table->max < len) {\n"
-            "        size_t m = table->max;\n"
-            "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
-            "        while (m < len && m != 0) m <<= 1;\n"
-            "        if (m == 0) m = len;\n"
-            "        table->buf = (pcc_value_t **)PCC_REALLOC(auxil, table->buf, sizeof(pcc_value_t *) * m);\n"
-            "        table->max = m;\n"
-            "    }\n"
-            "    for (i = table->len; i < len; i++) table->buf[i] = NULL;\n"
-            "    table->len = len;\n"
-            "}\n"
-            "\n"
-            "static void pcc_value_refer_table__term(pcc_auxil_t auxil, pcc_value_refer_table_t *table) {\n"
-            "    PCC_FREE(auxil, table->buf);\n"
-            "}\n"
-            "\n"
-        );
-        stream__puts(
-            &sstream,
-            "static void pcc_capture_table__init(pcc_auxil_t auxil, pcc_capture_table_t *table) {\n"
-            "    table->len = 0;\n"
-            "    table->max = 0;\n"
-            "    table->buf = NULL;\n"
-            "}\n"
-            "\n"
-            "MARK_FUNC_AS_USED\n"
-            "static void pcc_capture_table__resize(pcc_auxil_t auxil, pcc_capture_table_t *table, size_t len) {\n"
-            "    size_t i;\n"
-            "    for (i = len; i < table->len; i++) PCC_FREE(auxil, table->buf[i].string);\n"
-            "    if (table->max < len) {\n"
-            "        size_t m = table->max;\n"
-            "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
-            "        while (m < len && m != 0) m <<= 1;\n"
-            "        if (m == 0) m = len;\n"
-            "        table->buf = (pcc_capture_t *)PCC_REALLOC(auxil, table->buf, sizeof(pcc_capture_t) * m);\n"
-            "        table->max = m;\n"
-            "    }\n"
-            "    for (i = table->len; i < len; i++) {\n"
-            "        table->buf[i].range.start = 0;\n"
-            "        table->buf[i].range.end = 0;\n"
-            "        table->buf[i].string = NULL;\n"
-            "    }\n"
-            "    table->len = len;\n"
-            "}\n"
-            "\n"
-            "static void pcc_capture_table__term(pcc_auxil_t auxil, pcc_capture_table_t *table) {\n"
-            "    while (table->len > 0) {\n"
-            "        table->len--;\n"
-            "        PCC_FREE(auxil, table->buf[table->len].string);\n"
-            "    }\n"
-            "    PCC_FREE(auxil, table->buf);\n"
-            "}\n"
-            "\n"
-        );
-        stream__puts(
-            &sstream,
-            "static void pcc_capture_const_table__init(pcc_auxil_t auxil, pcc_capture_const_table_t *table) {\n"
-            "    table->len = 0;\n"
-            "    table->max = 0;\n"
-            "    table->buf = NULL;\n"
-            "}\n"
-            "\n"
-            "static void pcc_capture_const_table__resize(pcc_auxil_t auxil, pcc_capture_const_table_t *table, size_t len) {\n"
-            "    size_t i;\n"
-            "    if (table->max < len) {\n"
-            "        size_t m = table->max;\n"
-            "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
-            "        while (m < len && m != 0) m <<= 1;\n"
-            "        if (m == 0) m = len;\n"
-            "        table->buf = (const pcc_capture_t **)PCC_REALLOC(auxil, (pcc_capture_t **)table->buf, sizeof(const pcc_capture_t *) * m);\n"
-            "        table->max = m;\n"
-            "    }\n"
-            "    for (i = table->len; i < len; i++) table->buf[i] = NULL;\n"
-            "    table->len = len;\n"
-            "}\n"
-            "\n"
-            "static void pcc_capture_const_table__term(pcc_auxil_t auxil, pcc_capture_const_table_t *table) {\n"
-            "    PCC_FREE(auxil, (void *)table->buf);\n"
-            "}\n"
-            "\n"
-        );
-        stream__puts(
-            &sstream,
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__puts(
+                ts,
+                "static size_t pcc_arena__align(size_t size) {\n"
+                "    return (size + sizeof(pcc_arena_align_t) - 1) / sizeof(pcc_arena_align_t) * sizeof(pcc_arena_align_t);\n"
+                "}\n"
+                "\n"
+                "static void pcc_arena__init(pcc_auxil_t auxil, pcc_arena_t *arena) {\n"
+                "    arena->blocks = NULL;\n"
+                "}\n"
+                "\n"
+                "static void *pcc_arena__alloc(pcc_context_t *ctx, size_t size) {\n"
+                "    const size_t h = pcc_arena__align(sizeof(pcc_arena_block_t));\n"
+                "    pcc_arena_block_t *b = ctx->arena.blocks;\n"
+                "    void *p;\n"
+                "    size = pcc_arena__align(size);\n"
+                "    if (b == NULL || b->size - b->used < size) {\n"
+                "        size_t m = (b != NULL) ? b->size << 1 : PCC_ARENA_MIN_SIZE;\n"
+                "        if (m < size) m = size;\n"
+                "        b = (pcc_arena_block_t *)PCC_MALLOC(ctx->auxil, h + m);\n"
+                "        b->next = ctx->arena.blocks;\n"
+                "        b->size = m;\n"
+                "        b->used = 0;\n"
+                "        b->region = PCC_FALSE;\n"
+                "        ctx->arena.blocks = b;\n"
+                "        ctx->budget.used += h + m;\n"
+                "    }\n"
+                "    p = (char *)b + h + b->used;\n"
+                "    b->used += size;\n"
+                "    return p;\n"
+                "}\n"
+                "\n"
+                "static void *pcc_arena__realloc(pcc_context_t *ctx, void *ptr, size_t old_size, size_t size) {\n"
+                "    const size_t h = pcc_arena__align(sizeof(pcc_arena_block_t));\n"
+                "    pcc_arena_block_t *const b = ctx->arena.blocks;\n"
+                "    old_size = pcc_arena__align(old_size);\n"
+                "    size = pcc_arena__align(size);\n"
+                "    if (size <= old_size) return ptr;\n"
+                "    if (ptr != NULL && (char *)ptr + old_size == (char *)b + h + b->used && size - old_size <= b->size - b->used) {\n"
+                "        b->used += size - old_size; /* extends the last allocation in place */\n"
+                "        return ptr;\n"
+                "    }\n"
+                "    {\n"
+                "        void *const p = pcc_arena__alloc(ctx, size);\n"
+                "        if (old_size > 0) memcpy(p, ptr, old_size);\n"
+                "        return p;\n"
+                "    }\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "static char *pcc_arena__strndup(pcc_context_t *ctx, const char *str, size_t len) {\n"
+                "    const size_t m = strnlen(str, len);\n"
+                "    char *const s = (char *)pcc_arena__alloc(ctx, m + 1);\n"
+                "    memcpy(s, str, m);\n"
+                "    s[m] = '\\0';\n"
+                "    return s;\n"
+                "}\n"
+                "\n"
+                "static void pcc_arena__reset(pcc_auxil_t auxil, pcc_arena_t *arena) {\n"
+                "    /* keeps the region supplied if any, otherwise the latest block, which is the largest */\n"
+                "    pcc_arena_block_t *k = arena->blocks;\n"
+                "    pcc_arena_block_t *b;\n"
+                "    for (b = arena->blocks; b != NULL; b = b->next) {\n"
+                "        if (b->region) k = b;\n"
+                "    }\n"
+                "    while (arena->blocks != NULL) {\n"
+                "        b = arena->blocks;\n"
+                "        arena->blocks = b->next;\n"
+                "        if (b != k) PCC_FREE(auxil, b);\n"
+                "    }\n"
+                "    if (k != NULL) {\n"
+                "        k->next = NULL;\n"
+                "        k->used = 0;\n"
+                "    }\n"
+                "    arena->blocks = k;\n"
+                "}\n"
+                "\n"
+                "static size_t pcc_arena__size(pcc_auxil_t auxil, const pcc_arena_t *arena) {\n"
+                "    const size_t h = pcc_arena__align(sizeof(pcc_arena_block_t));\n"
+                "    size_t n = 0;\n"
+                "    const pcc_arena_block_t *b;\n"
+                "    for (b = arena->blocks; b != NULL; b = b->next) {\n"
+                "        if (!b->region) n += h + b->size;\n"
+                "    }\n"
+                "    return n;\n"
+                "}\n"
+                "\n"
+                "static void pcc_arena__trim(pcc_auxil_t auxil, pcc_arena_t *arena) {\n"
+                "    pcc_arena__reset(auxil, arena);\n"
+                "    if (arena->blocks != NULL && !arena->blocks->region) {\n"
+                "        PCC_FREE(auxil, arena->blocks);\n"
+                "        arena->blocks = NULL;\n"
+                "    }\n"
+                "}\n"
+                "\n"
+                "static void pcc_arena__term(pcc_auxil_t auxil, pcc_arena_t *arena) {\n"
+                "    while (arena->blocks != NULL) {\n"
+                "        pcc_arena_block_t *const b = arena->blocks;\n"
+                "        arena->blocks = b->next;\n"
+                "        if (!b->region) PCC_FREE(auxil, b);\n"
+                "    }\n"
+                "}\n"
+                "\n"
+            );
+            stream__printf(
+                ts,
+                "%svoid pcc_arena__set_region(pcc_auxil_t auxil, pcc_arena_t *arena, void *region, size_t size) {\n"
+                "    const size_t h = pcc_arena__align(sizeof(pcc_arena_block_t));\n"
+                "    pcc_arena__term(auxil, arena);\n"
+                "    if (region != NULL && size > h) {\n"
+                "        pcc_arena_block_t *const b = (pcc_arena_block_t *)region;\n"
+                "        b->next = NULL;\n"
+                "        b->size = size - h;\n"
+                "        b->used = 0;\n"
+                "        b->region = PCC_TRUE;\n"
+                "        arena->blocks = b;\n"
+                "    }\n"
+                "}\n"
+                "\n",
+                ac
+            );
+        }
+        stream__printf(
+            ts,
             "MARK_FUNC_AS_USED\n"
-            "static pcc_thunk_t *pcc_thunk__create_leaf(pcc_auxil_t auxil, pcc_action_t action, size_t valuec, size_t captc) {\n"
-            "    pcc_thunk_t *const thunk = (pcc_thunk_t *)PCC_MALLOC(auxil, sizeof(pcc_thunk_t));\n"
+            "%spcc_thunk_t *pcc_thunk__init_leaf(pcc_thunk_t *thunk, pcc_action_t action, pcc_value_t *values, const pcc_capture_t *capts) {\n"
             "    thunk->type = PCC_THUNK_LEAF;\n"
-            "    pcc_value_refer_table__init(auxil, &thunk->data.leaf.values);\n"
-            "    pcc_value_refer_table__resize(auxil, &thunk->data.leaf.values, valuec);\n"
-            "    pcc_capture_const_table__init(auxil, &thunk->data.leaf.capts);\n"
-            "    pcc_capture_const_table__resize(auxil, &thunk->data.leaf.capts, captc);\n"
+            "    thunk->data.leaf.values = values;\n"
+            "    thunk->data.leaf.capts = capts;\n"
             "    thunk->data.leaf.capt0.range.start = 0;\n"
             "    thunk->data.leaf.capt0.range.end = 0;\n"
             "    thunk->data.leaf.capt0.string = NULL;\n"
@@ -3840,77 +6400,109 @@ static bool_t generate(context_t *ctx) {
             "    return thunk;\n"
             "}\n"
             "\n"
-            "static pcc_thunk_t *pcc_thunk__create_node(pcc_auxil_t auxil, const pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
-            "    pcc_thunk_t *const thunk = (pcc_thunk_t *)PCC_MALLOC(auxil, sizeof(pcc_thunk_t));\n"
+            "static pcc_thunk_t *pcc_thunk__init_node(pcc_thunk_t *thunk, const pcc_thunk_array_t *thunks, pcc_value_t *value, pcc_value_t *source) {\n"
             "    thunk->type = PCC_THUNK_NODE;\n"
             "    thunk->data.node.thunks = thunks;\n"
             "    thunk->data.node.value = value;\n"
+            "    thunk->data.node.source = source;\n"
             "    return thunk;\n"
             "}\n"
             "\n"
-            "static void pcc_thunk__destroy(pcc_auxil_t auxil, pcc_thunk_t *thunk) {\n"
-            "    if (thunk == NULL) return;\n"
+            "%svoid pcc_thunk__term(pcc_context_t *ctx, pcc_thunk_t *thunk) {\n"
             "    switch (thunk->type) {\n"
             "    case PCC_THUNK_LEAF:\n"
-            "        PCC_FREE(auxil, thunk->data.leaf.capt0.string);\n"
-            "        pcc_capture_const_table__term(auxil, &thunk->data.leaf.capts);\n"
-            "        pcc_value_refer_table__term(auxil, &thunk->data.leaf.values);\n"
+            "%s"
             "        break;\n"
             "    case PCC_THUNK_NODE:\n"
             "        break;\n"
             "    default: /* unknown */\n"
             "        break;\n"
             "    }\n"
-            "    PCC_FREE(auxil, thunk);\n"
             "}\n"
-            "\n"
+            "\n",
+            sc, sc,
+            (ctx->flags & CODE_FLAG__INTERN) ?
+                "        /* the capture string is owned by the string table */\n" :
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "        /* the capture string is owned by the arena */\n" :
+                "        PCC_FREE(ctx->auxil, thunk->data.leaf.capt0.string);\n"
         );
-        stream__puts(
-            &sstream,
-            "static void pcc_thunk_array__init(pcc_auxil_t auxil, pcc_thunk_array_t *array) {\n"
+        stream__printf(
+            ts,
+            "static void pcc_thunk_array__init(pcc_context_t *ctx, pcc_thunk_array_t *array) {\n"
             "    array->len = 0;\n"
             "    array->max = 0;\n"
             "    array->buf = NULL;\n"
             "}\n"
             "\n"
-            "static void pcc_thunk_array__add(pcc_auxil_t auxil, pcc_thunk_array_t *array, pcc_thunk_t *thunk) {\n"
+            "static pcc_thunk_t *pcc_thunk_array__push(pcc_context_t *ctx, pcc_thunk_array_t *array) {\n"
             "    if (array->max <= array->len) {\n"
             "        const size_t n = array->len + 1;\n"
             "        size_t m = array->max;\n"
             "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
             "        while (m < n && m != 0) m <<= 1;\n"
             "        if (m == 0) m = n;\n"
-            "        array->buf = (pcc_thunk_t **)PCC_REALLOC(auxil, array->buf, sizeof(pcc_thunk_t *) * m);\n"
+            "        array->buf = (pcc_thunk_t *)%s;\n"
+            "%s"
             "        array->max = m;\n"
             "    }\n"
-            "    array->buf[array->len++] = thunk;\n"
+            "%s"
+            "    return &array->buf[array->len++];\n"
             "}\n"
             "\n"
-            "static void pcc_thunk_array__revert(pcc_auxil_t auxil, pcc_thunk_array_t *array, size_t len) {\n"
-            "    while (array->len > len) {\n"
-            "        array->len--;\n"
-            "        pcc_thunk__destroy(auxil, array->buf[array->len]);\n"
-            "    }\n"
+            "MARK_FUNC_AS_USED\n"
+            "%spcc_thunk_t *pcc_thunk_array__add_leaf(\n"
+            "    pcc_context_t *ctx, pcc_thunk_array_t *array, pcc_action_t action, pcc_value_t *values, const pcc_capture_t *capts\n"
+            ") {\n"
+            "    return pcc_thunk__init_leaf(pcc_thunk_array__push(ctx, array), action, values, capts);\n"
+            "}\n"
+            "\n"
+            "static void pcc_thunk_array__add_node(\n"
+            "    pcc_context_t *ctx, pcc_thunk_array_t *array, const pcc_thunk_array_t *thunks, pcc_value_t *value, pcc_value_t *source\n"
+            ") {\n"
+            "    pcc_thunk__init_node(pcc_thunk_array__push(ctx, array), thunks, value, source);\n"
+            "}\n"
+            "\n"
+            "%svoid pcc_thunk_array__revert(pcc_context_t *ctx, pcc_thunk_array_t *array, size_t len) {\n"
+            "    /* the thunks being discarded have never been evaluated, so they own no capture strings */\n"
+            "%s"
             "}\n"
             "\n"
-            "static void pcc_thunk_array__term(pcc_auxil_t auxil, pcc_thunk_array_t *array) {\n"
+            "static void pcc_thunk_array__term(pcc_context_t *ctx, pcc_thunk_array_t *array) {\n"
             "    while (array->len > 0) {\n"
             "        array->len--;\n"
-            "        pcc_thunk__destroy(auxil, array->buf[array->len]);\n"
+            "%s"
+            "        pcc_thunk__term(ctx, &array->buf[array->len]);\n"
             "    }\n"
-            "    PCC_FREE(auxil, array->buf);\n"
+            "%s"
             "}\n"
-            "\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "pcc_arena__realloc(ctx, array->buf, sizeof(pcc_thunk_t) * array->max, sizeof(pcc_thunk_t) * m)" :
+                "PCC_REALLOC(ctx->auxil, array->buf, sizeof(pcc_thunk_t) * m)",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "        ctx->budget.used += sizeof(pcc_thunk_t) * (m - array->max);\n",
+            (ctx->flags & CODE_FLAG__STATS) ? "    if (++ctx->stats.thunks > ctx->stats.thunks_peak) ctx->stats.thunks_peak = ctx->stats.thunks;\n" : "",
+            sc, sc,
+            (ctx->flags & CODE_FLAG__STATS) ?
+                "    if (array->len > len) {\n"
+                "        ctx->stats.thunks -= array->len - len;\n"
+                "        array->len = len;\n"
+                "    }\n" :
+                "    if (array->len > len) array->len = len;\n",
+            (ctx->flags & CODE_FLAG__STATS) ? "        ctx->stats.thunks--;\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" :
+                "    ctx->budget.used -= sizeof(pcc_thunk_t) * array->max;\n"
+                "    PCC_FREE(ctx->auxil, array->buf);\n"
         );
-        stream__puts(
-            &sstream,
-            "static void pcc_memory_recycler__init(pcc_auxil_t auxil, pcc_memory_recycler_t *recycler, size_t element_size) {\n"
+        stream__printf(
+            ts,
+            "static void pcc_memory_recycler__init(pcc_context_t *ctx, pcc_memory_recycler_t *recycler, size_t element_size) {\n"
             "    recycler->pool_list = NULL;\n"
             "    recycler->entry_list = NULL;\n"
             "    recycler->element_size = element_size;\n"
             "}\n"
             "\n"
-            "static void *pcc_memory_recycler__supply(pcc_auxil_t auxil, pcc_memory_recycler_t *recycler) {\n"
+            "static void *pcc_memory_recycler__supply(pcc_context_t *ctx, pcc_memory_recycler_t *recycler) {\n"
             "    if (recycler->entry_list) {\n"
             "        pcc_memory_entry_t *const tmp = recycler->entry_list;\n"
             "        recycler->entry_list = tmp->next;\n"
@@ -3923,64 +6515,341 @@ static bool_t generate(context_t *ctx) {
             "            if (size == 0) size = recycler->pool_list->allocated;\n"
             "        }\n"
             "        {\n"
-            "            pcc_memory_pool_t *const pool = (pcc_memory_pool_t *)PCC_MALLOC(\n"
-            "                auxil, sizeof(pcc_memory_pool_t) + recycler->element_size * size\n"
+            "            pcc_memory_pool_t *const pool = (pcc_memory_pool_t *)%s(\n"
+            "                %s, sizeof(pcc_memory_pool_t) + recycler->element_size * size\n"
             "            );\n"
             "            pool->allocated = size;\n"
             "            pool->unused = size;\n"
             "            pool->next = recycler->pool_list;\n"
             "            recycler->pool_list = pool;\n"
+            "%s"
             "        }\n"
             "    }\n"
             "    recycler->pool_list->unused--;\n"
             "    return (char *)recycler->pool_list + sizeof(pcc_memory_pool_t) + recycler->element_size * recycler->pool_list->unused;\n"
             "}\n"
             "\n"
-            "static void pcc_memory_recycler__recycle(pcc_auxil_t auxil, pcc_memory_recycler_t *recycler, void *ptr) {\n"
+            "static void pcc_memory_recycler__recycle(pcc_context_t *ctx, pcc_memory_recycler_t *recycler, void *ptr) {\n"
             "    pcc_memory_entry_t *const tmp = (pcc_memory_entry_t *)ptr;\n"
             "    tmp->next = recycler->entry_list;\n"
             "    recycler->entry_list = tmp;\n"
             "}\n"
             "\n"
-            "static void pcc_memory_recycler__term(pcc_auxil_t auxil, pcc_memory_recycler_t *recycler) {\n"
-            "    while (recycler->pool_list) {\n"
-            "        pcc_memory_pool_t *const tmp = recycler->pool_list;\n"
-            "        recycler->pool_list = tmp->next;\n"
-            "        PCC_FREE(auxil, tmp);\n"
+            "%ssize_t pcc_memory_recycler__size(const pcc_context_t *ctx, const pcc_memory_recycler_t *recycler) {\n"
+            "    size_t n = 0;\n"
+            "    const pcc_memory_pool_t *pool;\n"
+            "    for (pool = recycler->pool_list; pool; pool = pool->next) {\n"
+            "        n += sizeof(pcc_memory_pool_t) + recycler->element_size * pool->allocated;\n"
             "    }\n"
+            "    return n;\n"
             "}\n"
             "\n"
+            "static void pcc_memory_recycler__term(pcc_context_t *ctx, pcc_memory_recycler_t *recycler) {\n"
+            "%s"
+            "}\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ? "pcc_arena__alloc" : "PCC_MALLOC",
+            (ctx->flags & CODE_FLAG__ARENA) ? "ctx" : "ctx->auxil",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "            ctx->budget.used += sizeof(pcc_memory_pool_t) + recycler->element_size * size;\n",
+            ac,
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "    /* the pools are owned by the arena */\n"
+                "    recycler->pool_list = NULL;\n"
+                "    recycler->entry_list = NULL;\n" :
+                "    while (recycler->pool_list) {\n"
+                "        pcc_memory_pool_t *const tmp = recycler->pool_list;\n"
+                "        recycler->pool_list = tmp->next;\n"
+                "        ctx->budget.used -= sizeof(pcc_memory_pool_t) + recycler->element_size * tmp->allocated;\n"
+                "        PCC_FREE(ctx->auxil, tmp);\n"
+                "    }\n"
+                "    recycler->entry_list = NULL;\n"
         );
-        stream__puts(
-            &sstream,
+        if (ctx->flags & CODE_FLAG__EVENT) {
+            stream__printf(
+                ts,
+                "static void pcc_event_array__init(pcc_auxil_t auxil, pcc_event_array_t *array) {\n"
+                "    array->len = 0;\n"
+                "    array->max = 0;\n"
+                "    array->buf = NULL;\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_array__reserve(pcc_context_t *ctx, pcc_event_array_t *array, size_t len) {\n"
+                "    if (array->max < len) {\n"
+                "        size_t m = array->max;\n"
+                "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
+                "        while (m < len && m != 0) m <<= 1;\n"
+                "        if (m == 0) m = len;\n"
+                "        array->buf = (pcc_event_t *)PCC_REALLOC(ctx->auxil, array->buf, sizeof(pcc_event_t) * m);\n"
+                "        ctx->budget.used += sizeof(pcc_event_t) * (m - array->max);\n"
+                "        array->max = m;\n"
+                "    }\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_array__term(pcc_context_t *ctx, pcc_event_array_t *array) {\n"
+                "    ctx->budget.used -= sizeof(pcc_event_t) * array->max;\n"
+                "    PCC_FREE(ctx->auxil, array->buf);\n"
+                "}\n"
+                "\n"
+                "static void pcc_thunk_chunk_list__init(pcc_auxil_t auxil, pcc_thunk_chunk_list_t *list) {\n"
+                "    list->len = 0;\n"
+                "    list->max = 0;\n"
+                "    list->buf = NULL;\n"
+                "}\n"
+                "\n"
+                "static size_t pcc_thunk_chunk_list__add(pcc_context_t *ctx, pcc_thunk_chunk_list_t *list, pcc_thunk_chunk_t *chunk) {\n"
+                "    if (list->max <= list->len) {\n"
+                "        const size_t n = list->len + 1;\n"
+                "        size_t m = list->max;\n"
+                "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
+                "        while (m < n && m != 0) m <<= 1;\n"
+                "        if (m == 0) m = n;\n"
+                "        list->buf = (pcc_thunk_chunk_t **)PCC_REALLOC(ctx->auxil, list->buf, sizeof(pcc_thunk_chunk_t *) * m);\n"
+                "        ctx->budget.used += sizeof(pcc_thunk_chunk_t *) * (m - list->max);\n"
+                "        list->max = m;\n"
+                "    }\n"
+                "    list->buf[list->len] = chunk;\n"
+                "    return list->len++;\n"
+                "}\n"
+                "\n"
+                "static void pcc_thunk_chunk_list__term(pcc_context_t *ctx, pcc_thunk_chunk_list_t *list) {\n"
+                "    ctx->budget.used -= sizeof(pcc_thunk_chunk_t *) * list->max;\n"
+                "    PCC_FREE(ctx->auxil, list->buf);\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_log__init(pcc_auxil_t auxil, pcc_event_log_t *log) {\n"
+                "    pcc_event_array__init(auxil, &log->pending);\n"
+                "    pcc_event_array__init(auxil, &log->stash);\n"
+                "    pcc_thunk_chunk_list__init(auxil, &log->held);\n"
+                "    pcc_thunk_chunk_list__init(auxil, &log->stashed);\n"
+                "    log->base = 0;\n"
+                "    log->serial = 0;\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_log__clear(pcc_event_log_t *log) {\n"
+                "    /* the serial numbers keep increasing, so that the chunks cannot regard any later events as theirs */\n"
+                "    log->pending.len = 0;\n"
+                "    log->stash.len = 0;\n"
+                "    log->held.len = 0;\n"
+                "    log->stashed.len = 0;\n"
+                "    log->base = 0;\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_log__term(pcc_context_t *ctx, pcc_event_log_t *log) {\n"
+                "    pcc_thunk_chunk_list__term(ctx, &log->stashed);\n"
+                "    pcc_thunk_chunk_list__term(ctx, &log->held);\n"
+                "    pcc_event_array__term(ctx, &log->stash);\n"
+                "    pcc_event_array__term(ctx, &log->pending);\n"
+                "}\n"
+                "\n"
+                "static pcc_bool_t pcc_event_log__holds(const pcc_thunk_chunk_t *chunk) {\n"
+                "    const pcc_event_array_t *const a = chunk->events.array;\n"
+                "    return (a != NULL && chunk->events.end <= a->len && a->buf[chunk->events.end - 1].serial == chunk->events.serial) ? PCC_TRUE : PCC_FALSE;\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_log__forget(pcc_event_log_t *log, pcc_thunk_chunk_t *chunk) {\n"
+                "    pcc_thunk_chunk_list_t *const l = (chunk->events.array == &log->stash) ? &log->stashed : &log->held;\n"
+                "    if (chunk->events.array == NULL) return;\n"
+                "    if (chunk->events.index < l->len && l->buf[chunk->events.index] == chunk) l->buf[chunk->events.index] = NULL;\n"
+                "    chunk->events.array = NULL;\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "%svoid pcc_event_log__add(pcc_context_t *ctx, pcc_event_log_t *log, pcc_event_handler_t handler, size_t start, size_t end) {\n"
+                "    pcc_event_t *e;\n"
+                "    pcc_event_array__reserve(ctx, &log->pending, log->pending.len + 1);\n"
+                "    e = &log->pending.buf[log->pending.len++];\n"
+                "    e->handler = handler;\n"
+                "    e->range.start = start;\n"
+                "    e->range.end = end;\n"
+                "    e->serial = log->serial++;\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "%svoid pcc_event_log__open(pcc_context_t *ctx, pcc_event_log_t *log, pcc_thunk_chunk_t *chunk, pcc_event_handler_t handler) {\n"
+                "    chunk->events.start = log->base + log->pending.len;\n"
+                "    pcc_event_log__add(ctx, log, handler, chunk->pos, PCC_VOID_VALUE);\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "%svoid pcc_event_log__close(pcc_context_t *ctx, pcc_event_log_t *log, pcc_thunk_chunk_t *chunk, pcc_event_handler_t handler) {\n"
+                "    /* the entering event has been committed already if the rule encloses a commit point */\n"
+                "    const size_t s = (chunk->events.start > log->base) ? chunk->events.start - log->base : 0;\n"
+                "    if (chunk->events.start >= log->base) log->pending.buf[s].range.end = ctx->cur;\n"
+                "    pcc_event_log__add(ctx, log, handler, chunk->pos, ctx->cur);\n"
+                "    chunk->events.array = &log->pending;\n"
+                "    chunk->events.start = s;\n"
+                "    chunk->events.end = log->pending.len;\n"
+                "    chunk->events.serial = log->pending.buf[log->pending.len - 1].serial;\n"
+                "    chunk->events.index = pcc_thunk_chunk_list__add(ctx, &log->held, chunk);\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "%svoid pcc_event_log__revert(pcc_context_t *ctx, pcc_event_log_t *log, size_t mark) {\n"
+                "    /* the events of the memos being discarded are moved to the stash, so that they can be replayed */\n"
+                "    const size_t s = (mark > log->base) ? mark - log->base : 0;\n"
+                "    size_t k = log->held.len, lo = PCC_VOID_VALUE, hi = 0, i;\n"
+                "    if (s >= log->pending.len) return;\n"
+                "    while (k > 0 && (log->held.buf[k - 1] == NULL || log->held.buf[k - 1]->events.end > s)) {\n"
+                "        const pcc_thunk_chunk_t *const c = log->held.buf[--k];\n"
+                "        if (c == NULL) continue;\n"
+                "        if (lo > c->events.start) lo = c->events.start;\n"
+                "        if (hi < c->events.end) hi = c->events.end;\n"
+                "    }\n"
+                "    if (lo < hi) {\n"
+                "        const size_t t = log->stash.len;\n"
+                "        pcc_event_array__reserve(ctx, &log->stash, t + hi - lo);\n"
+                "        memcpy(log->stash.buf + t, log->pending.buf + lo, sizeof(pcc_event_t) * (hi - lo));\n"
+                "        log->stash.len += hi - lo;\n"
+                "        for (i = k; i < log->held.len; i++) {\n"
+                "            pcc_thunk_chunk_t *const c = log->held.buf[i];\n"
+                "            if (c == NULL) continue;\n"
+                "            c->events.array = &log->stash;\n"
+                "            c->events.start += t - lo;\n"
+                "            c->events.end += t - lo;\n"
+                "            c->events.index = pcc_thunk_chunk_list__add(ctx, &log->stashed, c);\n"
+                "        }\n"
+                "    }\n"
+                "    log->held.len = k;\n"
+                "    log->pending.len = s;\n"
+                "}\n"
+                "\n"
+                "static void pcc_event_log__settle(pcc_context_t *ctx, pcc_event_log_t *log, const pcc_thunk_chunk_t *chunk, size_t mark) {\n"
+                "    /* makes the events pending after the mark be those of the chunk; nothing is replayed if they have been committed */\n"
+                "    const size_t s = (mark > log->base) ? mark - log->base : 0;\n"
+                "    const pcc_event_array_t *a;\n"
+                "    size_t i;\n"
+                "    if (chunk->events.array == &log->pending && chunk->events.start == s && chunk->events.end == log->pending.len) return;\n"
+                "    pcc_event_log__revert(ctx, log, mark);\n"
+                "    if (!pcc_event_log__holds(chunk)) return;\n"
+                "    pcc_event_array__reserve(ctx, &log->pending, log->pending.len + chunk->events.end - chunk->events.start);\n"
+                "    a = chunk->events.array;\n"
+                "    for (i = chunk->events.start; i < chunk->events.end; i++) {\n"
+                "        pcc_event_t *const e = &log->pending.buf[log->pending.len++];\n"
+                "        *e = a->buf[i];\n"
+                "        e->serial = log->serial++;\n"
+                "    }\n"
+                "}\n"
+                "\n"
+                "MARK_FUNC_AS_USED\n"
+                "%svoid pcc_event_log__commit(pcc_context_t *ctx, pcc_event_log_t *log) {\n"
+                "    /* delivers the pending events, and keeps only the events of the memos ahead of the current position */\n"
+                "    pcc_event_array_t a;\n"
+                "    size_t i, j, k = 0;\n"
+                "    for (i = 0; i < log->pending.len; i++) {\n"
+                "        pcc_event_t *const e = &log->pending.buf[i];\n"
+                "        if (e->range.end == PCC_VOID_VALUE) e->range.end = ctx->cur; /* the rule enclosing the commit point */\n"
+                "        e->handler(ctx, e);\n"
+                "    }\n"
+                "    pcc_event_array__init(ctx->auxil, &a);\n"
+                "    for (j = 0; j < 2; j++) {\n"
+                "        pcc_thunk_chunk_list_t *const l = (j == 0) ? &log->stashed : &log->held;\n"
+                "        for (i = 0; i < l->len; i++) {\n"
+                "            pcc_thunk_chunk_t *const c = l->buf[i];\n"
+                "            if (c == NULL) continue;\n"
+                "            if (c->pos < ctx->cur || !pcc_event_log__holds(c)) {\n"
+                "                c->events.array = NULL;\n"
+                "                continue;\n"
+                "            }\n"
+                "            pcc_event_array__reserve(ctx, &a, a.len + c->events.end - c->events.start);\n"
+                "            memcpy(a.buf + a.len, c->events.array->buf + c->events.start, sizeof(pcc_event_t) * (c->events.end - c->events.start));\n"
+                "            c->events.array = &log->stash;\n"
+                "            c->events.end += a.len - c->events.start;\n"
+                "            c->events.start = a.len;\n"
+                "            a.len = c->events.end;\n"
+                "            if (j == 0)\n"
+                "                log->stashed.buf[k] = c;\n"
+                "            else\n"
+                "                pcc_thunk_chunk_list__add(ctx, &log->stashed, c);\n"
+                "            c->events.index = k++;\n"
+                "        }\n"
+                "        if (j == 0) log->stashed.len = k;\n"
+                "    }\n"
+                "    pcc_event_array__term(ctx, &log->stash);\n"
+                "    log->stash = a;\n"
+                "    log->held.len = 0;\n"
+                "    log->base += log->pending.len;\n"
+                "    log->pending.len = 0;\n"
+                "}\n"
+                "\n",
+                sc, sc, sc, sc, sc
+            );
+        }
+        stream__printf(
+            ts,
+            "static size_t pcc_thunk_chunk__align(size_t size) {\n"
+            "    return (size + sizeof(pcc_thunk_chunk_align_t) - 1) / sizeof(pcc_thunk_chunk_align_t) * sizeof(pcc_thunk_chunk_align_t);\n"
+            "}\n"
+            "\n"
+            "static size_t pcc_thunk_chunk__size(size_t valuec, size_t captc) {\n"
+            "    return\n"
+            "        pcc_thunk_chunk__align(sizeof(pcc_thunk_chunk_t)) +\n"
+            "        pcc_thunk_chunk__align(sizeof(pcc_value_t) * valuec) +\n"
+            "        pcc_thunk_chunk__align(sizeof(pcc_capture_t) * captc);\n"
+            "}\n"
+            "\n"
             "MARK_FUNC_AS_USED\n"
-            "static pcc_thunk_chunk_t *pcc_thunk_chunk__create(pcc_context_t *ctx) {\n"
-            "    pcc_thunk_chunk_t *const chunk = (pcc_thunk_chunk_t *)pcc_memory_recycler__supply(ctx->auxil, &ctx->thunk_chunk_recycler);\n"
-            "    pcc_value_table__init(ctx->auxil, &chunk->values);\n"
-            "    pcc_capture_table__init(ctx->auxil, &chunk->capts);\n"
-            "    pcc_thunk_array__init(ctx->auxil, &chunk->thunks);\n"
+            "%spcc_thunk_chunk_t *pcc_thunk_chunk__create(pcc_context_t *ctx, pcc_memory_recycler_t *recycler, size_t valuec, size_t captc) {\n"
+            "    pcc_thunk_chunk_t *const chunk = (pcc_thunk_chunk_t *)pcc_memory_recycler__supply(ctx, recycler);\n"
+            "    size_t i;\n"
+            "    chunk->values = (pcc_value_t *)((char *)chunk + pcc_thunk_chunk__align(sizeof(pcc_thunk_chunk_t)));\n"
+            "    chunk->capts = (pcc_capture_t *)((char *)chunk->values + pcc_thunk_chunk__align(sizeof(pcc_value_t) * valuec));\n"
+            "    chunk->valuec = valuec;\n"
+            "    chunk->captc = captc;\n"
+            "    for (i = 0; i < valuec; i++) {\n"
+            "        PCC_VALUE_INIT(ctx->auxil, &chunk->values[i]);\n"
+            "    }\n"
+            "    for (i = 0; i < captc; i++) {\n"
+            "        chunk->capts[i].range.start = 0;\n"
+            "        chunk->capts[i].range.end = 0;\n"
+            "        chunk->capts[i].string = NULL;\n"
+            "    }\n"
+            "    pcc_thunk_array__init(ctx, &chunk->thunks);\n"
             "    chunk->pos = 0;\n"
+            "    chunk->recycler = recycler;\n"
+            "    chunk->evaluated = PCC_FALSE;\n"
+            "%s"
+            "%s"
             "    return chunk;\n"
             "}\n"
             "\n"
-            "static void pcc_thunk_chunk__destroy(pcc_context_t *ctx, pcc_thunk_chunk_t *chunk) {\n"
-            "    if (chunk == NULL) return;\n"
-            "    pcc_thunk_array__term(ctx->auxil, &chunk->thunks);\n"
-            "    pcc_capture_table__term(ctx->auxil, &chunk->capts);\n"
-            "    pcc_value_table__term(ctx->auxil, &chunk->values);\n"
-            "    pcc_memory_recycler__recycle(ctx->auxil, &ctx->thunk_chunk_recycler, chunk);\n"
+            "%svoid pcc_thunk_chunk__destroy(pcc_context_t *ctx, pcc_thunk_chunk_t *chunk) {\n"
+            "    if (chunk == NULL || chunk == &ctx->void_chunk) return;\n"
+            "%s"
+            "%s"
+            "    pcc_thunk_array__term(ctx, &chunk->thunks);\n"
+            "    if (chunk->evaluated) PCC_VALUE_DESTROY(ctx->auxil, &chunk->value);\n"
+            "    while (chunk->valuec > 0) {\n"
+            "        chunk->valuec--;\n"
+            "        PCC_VALUE_DESTROY(ctx->auxil, &chunk->values[chunk->valuec]);\n"
+            "    }\n"
+            "%s"
+            "    pcc_memory_recycler__recycle(ctx, chunk->recycler, chunk);\n"
             "}\n"
-            "\n"
+            "\n",
+            sc,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    chunk->events.array = NULL;\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "    if (++ctx->stats.chunks > ctx->stats.chunks_peak) ctx->stats.chunks_peak = ctx->stats.chunks;\n" : "",
+            sc,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__forget(&ctx->events, chunk);\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "    ctx->stats.chunks--;\n" : "",
+            (ctx->flags & CODE_FLAG__INTERN) ?
+                "    /* the capture strings are owned by the string table */\n" :
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "    /* the capture strings are owned by the arena */\n" :
+                "    while (chunk->captc > 0) {\n"
+                "        chunk->captc--;\n"
+                "        PCC_FREE(ctx->auxil, chunk->capts[chunk->captc].string);\n"
+                "    }\n"
         );
-        stream__puts(
-            &sstream,
-            "static void pcc_rule_set__init(pcc_auxil_t auxil, pcc_rule_set_t *set) {\n"
+        stream__printf(
+            ts,
+            "static void pcc_rule_set__init(pcc_context_t *ctx, pcc_rule_set_t *set) {\n"
             "    set->len = 0;\n"
             "    set->max = 0;\n"
             "    set->buf = NULL;\n"
             "}\n"
             "\n"
-            "static size_t pcc_rule_set__index(pcc_auxil_t auxil, const pcc_rule_set_t *set, pcc_rule_t rule) {\n"
+            "static size_t pcc_rule_set__index(pcc_context_t *ctx, const pcc_rule_set_t *set, pcc_rule_t rule) {\n"
             "    size_t i;\n"
             "    for (i = 0; i < set->len; i++) {\n"
             "        if (set->buf[i] == rule) return i;\n"
@@ -3988,8 +6857,8 @@ static bool_t generate(context_t *ctx) {
             "    return PCC_VOID_VALUE;\n"
             "}\n"
             "\n"
-            "static pcc_bool_t pcc_rule_set__add(pcc_auxil_t auxil, pcc_rule_set_t *set, pcc_rule_t rule) {\n"
-            "    const size_t i = pcc_rule_set__index(auxil, set, rule);\n"
+            "static pcc_bool_t pcc_rule_set__add(pcc_context_t *ctx, pcc_rule_set_t *set, pcc_rule_t rule) {\n"
+            "    const size_t i = pcc_rule_set__index(ctx, set, rule);\n"
             "    if (i != PCC_VOID_VALUE) return PCC_FALSE;\n"
             "    if (set->max <= set->len) {\n"
             "        const size_t n = set->len + 1;\n"
@@ -3997,44 +6866,52 @@ static bool_t generate(context_t *ctx) {
             "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
             "        while (m < n && m != 0) m <<= 1;\n"
             "        if (m == 0) m = n;\n"
-            "        set->buf = (pcc_rule_t *)PCC_REALLOC(auxil, set->buf, sizeof(pcc_rule_t) * m);\n"
+            "        set->buf = (pcc_rule_t *)%s;\n"
+            "%s"
             "        set->max = m;\n"
             "    }\n"
             "    set->buf[set->len++] = rule;\n"
             "    return PCC_TRUE;\n"
             "}\n"
             "\n"
-            "static pcc_bool_t pcc_rule_set__remove(pcc_auxil_t auxil, pcc_rule_set_t *set, pcc_rule_t rule) {\n"
-            "    const size_t i = pcc_rule_set__index(auxil, set, rule);\n"
+            "static pcc_bool_t pcc_rule_set__remove(pcc_context_t *ctx, pcc_rule_set_t *set, pcc_rule_t rule) {\n"
+            "    const size_t i = pcc_rule_set__index(ctx, set, rule);\n"
             "    if (i == PCC_VOID_VALUE) return PCC_FALSE;\n"
             "    memmove(set->buf + i, set->buf + (i + 1), sizeof(pcc_rule_t) * (set->len - (i + 1)));\n"
             "    return PCC_TRUE;\n"
             "}\n"
             "\n"
-            "static void pcc_rule_set__clear(pcc_auxil_t auxil, pcc_rule_set_t *set) {\n"
+            "static void pcc_rule_set__clear(pcc_context_t *ctx, pcc_rule_set_t *set) {\n"
             "    set->len = 0;\n"
             "}\n"
             "\n"
-            "static void pcc_rule_set__copy(pcc_auxil_t auxil, pcc_rule_set_t *set, const pcc_rule_set_t *src) {\n"
+            "static void pcc_rule_set__copy(pcc_context_t *ctx, pcc_rule_set_t *set, const pcc_rule_set_t *src) {\n"
             "    size_t i;\n"
-            "    pcc_rule_set__clear(auxil, set);\n"
+            "    pcc_rule_set__clear(ctx, set);\n"
             "    for (i = 0; i < src->len; i++) {\n"
-            "        pcc_rule_set__add(auxil, set, src->buf[i]);\n"
+            "        pcc_rule_set__add(ctx, set, src->buf[i]);\n"
             "    }\n"
             "}\n"
             "\n"
-            "static void pcc_rule_set__term(pcc_auxil_t auxil, pcc_rule_set_t *set) {\n"
-            "    PCC_FREE(auxil, set->buf);\n"
+            "static void pcc_rule_set__term(pcc_context_t *ctx, pcc_rule_set_t *set) {\n"
+            "%s"
             "}\n"
-            "\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "pcc_arena__realloc(ctx, set->buf, sizeof(pcc_rule_t) * set->max, sizeof(pcc_rule_t) * m)" :
+                "PCC_REALLOC(ctx->auxil, set->buf, sizeof(pcc_rule_t) * m)",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "        ctx->budget.used += sizeof(pcc_rule_t) * (m - set->max);\n",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" :
+                "    ctx->budget.used -= sizeof(pcc_rule_t) * set->max;\n"
+                "    PCC_FREE(ctx->auxil, set->buf);\n"
         );
         stream__puts(
-            &sstream,
+            ts,
             "static pcc_lr_head_t *pcc_lr_head__create(pcc_context_t *ctx, pcc_rule_t rule) {\n"
-            "    pcc_lr_head_t *const head = (pcc_lr_head_t *)pcc_memory_recycler__supply(ctx->auxil, &ctx->lr_head_recycler);\n"
+            "    pcc_lr_head_t *const head = (pcc_lr_head_t *)pcc_memory_recycler__supply(ctx, &ctx->lr_head_recycler);\n"
             "    head->rule = rule;\n"
-            "    pcc_rule_set__init(ctx->auxil, &head->invol);\n"
-            "    pcc_rule_set__init(ctx->auxil, &head->eval);\n"
+            "    pcc_rule_set__init(ctx, &head->invol);\n"
+            "    pcc_rule_set__init(ctx, &head->eval);\n"
             "    head->hold = NULL;\n"
             "    return head;\n"
             "}\n"
@@ -4042,18 +6919,18 @@ static bool_t generate(context_t *ctx) {
             "static void pcc_lr_head__destroy(pcc_context_t *ctx, pcc_lr_head_t *head) {\n"
             "    if (head == NULL) return;\n"
             "    pcc_lr_head__destroy(ctx, head->hold);\n"
-            "    pcc_rule_set__term(ctx->auxil, &head->eval);\n"
-            "    pcc_rule_set__term(ctx->auxil, &head->invol);\n"
-            "    pcc_memory_recycler__recycle(ctx->auxil, &ctx->lr_head_recycler, head);\n"
+            "    pcc_rule_set__term(ctx, &head->eval);\n"
+            "    pcc_rule_set__term(ctx, &head->invol);\n"
+            "    pcc_memory_recycler__recycle(ctx, &ctx->lr_head_recycler, head);\n"
             "}\n"
             "\n"
         );
         stream__puts(
-            &sstream,
-            "static void pcc_lr_entry__destroy(pcc_auxil_t auxil, pcc_lr_entry_t *lr);\n"
+            ts,
+            "static void pcc_lr_entry__destroy(pcc_context_t *ctx, pcc_lr_entry_t *lr);\n"
             "\n"
             "static pcc_lr_answer_t *pcc_lr_answer__create(pcc_context_t *ctx, pcc_lr_answer_type_t type, size_t pos) {\n"
-            "    pcc_lr_answer_t *answer = (pcc_lr_answer_t *)pcc_memory_recycler__supply(ctx->auxil, &ctx->lr_answer_recycler);\n"
+            "    pcc_lr_answer_t *answer = (pcc_lr_answer_t *)pcc_memory_recycler__supply(ctx, &ctx->lr_answer_recycler);\n"
             "    answer->type = type;\n"
             "    answer->pos = pos;\n"
             "    answer->hold = NULL;\n"
@@ -4094,7 +6971,7 @@ static bool_t generate(context_t *ctx) {
             "        pcc_lr_answer_t *const a = answer->hold;\n"
             "        switch (answer->type) {\n"
             "        case PCC_LR_ANSWER_LR:\n"
-            "            pcc_lr_entry__destroy(ctx->auxil, answer->data.lr);\n"
+            "            pcc_lr_entry__destroy(ctx, answer->data.lr);\n"
             "            break;\n"
             "        case PCC_LR_ANSWER_CHUNK:\n"
             "            pcc_thunk_chunk__destroy(ctx, answer->data.chunk);\n"
@@ -4102,14 +6979,14 @@ static bool_t generate(context_t *ctx) {
             "        default: /* unknown */\n"
             "            break;\n"
             "        }\n"
-            "        pcc_memory_recycler__recycle(ctx->auxil, &ctx->lr_answer_recycler, answer);\n"
+            "        pcc_memory_recycler__recycle(ctx, &ctx->lr_answer_recycler, answer);\n"
             "        answer = a;\n"
             "    }\n"
             "}\n"
             "\n"
         );
-        stream__puts(
-            &sstream,
+        stream__printf(
+            ts,
             "static void pcc_lr_memo_map__init(pcc_auxil_t auxil, pcc_lr_memo_map_t *map) {\n"
             "    map->len = 0;\n"
             "    map->max = 0;\n"
@@ -4137,15 +7014,23 @@ static bool_t generate(context_t *ctx) {
             "            if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
             "            while (m < n && m != 0) m <<= 1;\n"
             "            if (m == 0) m = n;\n"
-            "            map->buf = (pcc_lr_memo_t *)PCC_REALLOC(ctx->auxil, map->buf, sizeof(pcc_lr_memo_t) * m);\n"
+            "            map->buf = (pcc_lr_memo_t *)%s;\n"
+            "%s"
             "            map->max = m;\n"
             "        }\n"
             "        map->buf[map->len].rule = rule;\n"
             "        map->buf[map->len].answer = answer;\n"
             "        map->len++;\n"
+            "%s"
             "    }\n"
             "}\n"
             "\n"
+            "static void pcc_lr_memo_map__remove(pcc_context_t *ctx, pcc_lr_memo_map_t *map, size_t index) {\n"
+            "    pcc_lr_answer__destroy(ctx, map->buf[index].answer);\n"
+            "    map->buf[index] = map->buf[--map->len];\n"
+            "%s"
+            "}\n"
+            "\n"
             "static pcc_lr_answer_t *pcc_lr_memo_map__get(pcc_context_t *ctx, pcc_lr_memo_map_t *map, pcc_rule_t rule) {\n"
             "    const size_t i = pcc_lr_memo_map__index(ctx, map, rule);\n"
             "    return (i != PCC_VOID_VALUE) ? map->buf[i].answer : NULL;\n"
@@ -4154,20 +7039,32 @@ static bool_t generate(context_t *ctx) {
             "static void pcc_lr_memo_map__term(pcc_context_t *ctx, pcc_lr_memo_map_t *map) {\n"
             "    while (map->len > 0) {\n"
             "        map->len--;\n"
+            "%s"
             "        pcc_lr_answer__destroy(ctx, map->buf[map->len].answer);\n"
             "    }\n"
-            "    PCC_FREE(ctx->auxil, map->buf);\n"
+            "%s"
             "}\n"
-            "\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "pcc_arena__realloc(ctx, map->buf, sizeof(pcc_lr_memo_t) * map->max, sizeof(pcc_lr_memo_t) * m)" :
+                "PCC_REALLOC(ctx->auxil, map->buf, sizeof(pcc_lr_memo_t) * m)",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "            ctx->budget.used += sizeof(pcc_lr_memo_t) * (m - map->max);\n",
+            (ctx->flags & CODE_FLAG__STATS) ? "        if (++ctx->stats.memos > ctx->stats.memos_peak) ctx->stats.memos_peak = ctx->stats.memos;\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "    ctx->stats.memos--;\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "        ctx->stats.memos--;\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" :
+                "    ctx->budget.used -= sizeof(pcc_lr_memo_t) * map->max;\n"
+                "    PCC_FREE(ctx->auxil, map->buf);\n"
         );
-        stream__puts(
-            &sstream,
+        stream__printf(
+            ts,
             "static pcc_lr_table_entry_t *pcc_lr_table_entry__create(pcc_context_t *ctx) {\n"
-            "    pcc_lr_table_entry_t *const entry = (pcc_lr_table_entry_t *)PCC_MALLOC(ctx->auxil, sizeof(pcc_lr_table_entry_t));\n"
+            "    pcc_lr_table_entry_t *const entry = (pcc_lr_table_entry_t *)%s;\n"
             "    entry->head = NULL;\n"
             "    pcc_lr_memo_map__init(ctx->auxil, &entry->memos);\n"
             "    entry->hold_a = NULL;\n"
             "    entry->hold_h = NULL;\n"
+            "%s"
             "    return entry;\n"
             "}\n"
             "\n"
@@ -4176,12 +7073,19 @@ static bool_t generate(context_t *ctx) {
             "    pcc_lr_head__destroy(ctx, entry->hold_h);\n"
             "    pcc_lr_answer__destroy(ctx, entry->hold_a);\n"
             "    pcc_lr_memo_map__term(ctx, &entry->memos);\n"
-            "    PCC_FREE(ctx->auxil, entry);\n"
+            "%s"
             "}\n"
-            "\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "pcc_arena__alloc(ctx, sizeof(pcc_lr_table_entry_t))" :
+                "PCC_MALLOC(ctx->auxil, sizeof(pcc_lr_table_entry_t))",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "    ctx->budget.used += sizeof(pcc_lr_table_entry_t);\n",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" :
+                "    ctx->budget.used -= sizeof(pcc_lr_table_entry_t);\n"
+                "    PCC_FREE(ctx->auxil, entry);\n"
         );
         stream__puts(
-            &sstream,
+            ts,
             "static void pcc_lr_table__init(pcc_auxil_t auxil, pcc_lr_table_t *table) {\n"
             "    table->ofs = 0;\n"
             "    table->len = 0;\n"
@@ -4198,6 +7102,7 @@ static bool_t generate(context_t *ctx) {
             "        while (m < len && m != 0) m <<= 1;\n"
             "        if (m == 0) m = len;\n"
             "        table->buf = (pcc_lr_table_entry_t **)PCC_REALLOC(ctx->auxil, table->buf, sizeof(pcc_lr_table_entry_t *) * m);\n"
+            "        ctx->budget.used += sizeof(pcc_lr_table_entry_t *) * (m - table->max);\n"
             "        table->max = m;\n"
             "    }\n"
             "    for (i = table->len; i < len; i++) table->buf[i] = NULL;\n"
@@ -4257,32 +7162,63 @@ static bool_t generate(context_t *ctx) {
             "    }\n"
             "}\n"
             "\n"
+            "static void pcc_lr_table__forget_failures(pcc_context_t *ctx, pcc_lr_table_t *table, size_t index) {\n"
+            "    /* discards the memos of the rules failed at the position, which are evaluated again if needed; */\n"
+            "    /* the memos of the matched rules are kept since the thunks refer to them */\n"
+            "    pcc_lr_table_entry_t *e;\n"
+            "    size_t i = 0;\n"
+            "    index += table->ofs;\n"
+            "    if (index >= table->len || table->buf[index] == NULL) return;\n"
+            "    e = table->buf[index];\n"
+            "    if (e->head != NULL) return; /* a left recursion is being grown */\n"
+            "    while (i < e->memos.len) {\n"
+            "        const pcc_lr_answer_t *const a = e->memos.buf[i].answer;\n"
+            "        if (a->type == PCC_LR_ANSWER_CHUNK && a->data.chunk == NULL)\n"
+            "            pcc_lr_memo_map__remove(ctx, &e->memos, i);\n"
+            "        else\n"
+            "            i++;\n"
+            "    }\n"
+            "    if (e->memos.len == 0 && e->hold_a == NULL && e->hold_h == NULL) {\n"
+            "        pcc_lr_table_entry__destroy(ctx, e);\n"
+            "        table->buf[index] = NULL;\n"
+            "    }\n"
+            "}\n"
+            "\n"
             "static void pcc_lr_table__term(pcc_context_t *ctx, pcc_lr_table_t *table) {\n"
             "    while (table->len > table->ofs) {\n"
             "        table->len--;\n"
             "        pcc_lr_table_entry__destroy(ctx, table->buf[table->len]);\n"
             "    }\n"
+            "    ctx->budget.used -= sizeof(pcc_lr_table_entry_t *) * table->max;\n"
             "    PCC_FREE(ctx->auxil, table->buf);\n"
             "}\n"
             "\n"
         );
-        stream__puts(
-            &sstream,
-            "static pcc_lr_entry_t *pcc_lr_entry__create(pcc_auxil_t auxil, pcc_rule_t rule) {\n"
-            "    pcc_lr_entry_t *const lr = (pcc_lr_entry_t *)PCC_MALLOC(auxil, sizeof(pcc_lr_entry_t));\n"
+        stream__printf(
+            ts,
+            "static pcc_lr_entry_t *pcc_lr_entry__create(pcc_context_t *ctx, pcc_rule_t rule) {\n"
+            "    pcc_lr_entry_t *const lr = (pcc_lr_entry_t *)%s;\n"
             "    lr->rule = rule;\n"
             "    lr->seed = NULL;\n"
             "    lr->head = NULL;\n"
+            "%s"
             "    return lr;\n"
             "}\n"
             "\n"
-            "static void pcc_lr_entry__destroy(pcc_auxil_t auxil, pcc_lr_entry_t *lr) {\n"
-            "    PCC_FREE(auxil, lr);\n"
+            "static void pcc_lr_entry__destroy(pcc_context_t *ctx, pcc_lr_entry_t *lr) {\n"
+            "%s"
             "}\n"
-            "\n"
+            "\n",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "pcc_arena__alloc(ctx, sizeof(pcc_lr_entry_t))" :
+                "PCC_MALLOC(ctx->auxil, sizeof(pcc_lr_entry_t))",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" : "    ctx->budget.used += sizeof(pcc_lr_entry_t);\n",
+            (ctx->flags & CODE_FLAG__ARENA) ? "" :
+                "    if (lr != NULL) ctx->budget.used -= sizeof(pcc_lr_entry_t);\n"
+                "    PCC_FREE(ctx->auxil, lr);\n"
         );
         stream__puts(
-            &sstream,
+            ts,
             "static void pcc_lr_stack__init(pcc_auxil_t auxil, pcc_lr_stack_t *stack) {\n"
             "    stack->len = 0;\n"
             "    stack->max = 0;\n"
@@ -4312,93 +7248,635 @@ static bool_t generate(context_t *ctx) {
             "\n"
         );
         stream__puts(
-            &sstream,
-            "static pcc_context_t *pcc_context__create(pcc_auxil_t auxil) {\n"
+            ts,
+            "static void pcc_thunk_stack__init(pcc_auxil_t auxil, pcc_thunk_stack_t *stack) {\n"
+            "    stack->len = 0;\n"
+            "    stack->max = 0;\n"
+            "    stack->buf = NULL;\n"
+            "}\n"
+            "\n"
+            "static void pcc_thunk_stack__push(pcc_context_t *ctx, pcc_thunk_stack_t *stack, const pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
+            "    if (stack->max <= stack->len) {\n"
+            "        const size_t n = stack->len + 1;\n"
+            "        size_t m = stack->max;\n"
+            "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
+            "        while (m < n && m != 0) m <<= 1;\n"
+            "        if (m == 0) m = n;\n"
+            "        stack->buf = (pcc_thunk_frame_t *)PCC_REALLOC(ctx->auxil, stack->buf, sizeof(pcc_thunk_frame_t) * m);\n"
+            "        stack->max = m;\n"
+            "    }\n"
+            "    stack->buf[stack->len].thunks = thunks;\n"
+            "    stack->buf[stack->len].index = 0;\n"
+            "    stack->buf[stack->len].value = value;\n"
+            "    if (value == NULL) PCC_VALUE_INIT(ctx->auxil, &stack->buf[stack->len].scratch);\n"
+            "    stack->len++;\n"
+            "}\n"
+            "\n"
+            "static void pcc_thunk_stack__term(pcc_auxil_t auxil, pcc_thunk_stack_t *stack) {\n"
+            "    PCC_FREE(auxil, stack->buf);\n"
+            "}\n"
+            "\n"
+        );
+        if (ctx->flags & CODE_FLAG__INTERN) {
+            stream__printf(
+                ts,
+                "static size_t pcc_hash_string(const char *str, size_t len) {\n"
+                "    size_t h = 5381;\n"
+                "    size_t i;\n"
+                "    for (i = 0; i < len; i++) h = (h * 33) ^ (size_t)(unsigned char)str[i];\n"
+                "    return h;\n"
+                "}\n"
+                "\n"
+                "static void pcc_string_table__init(pcc_auxil_t auxil, pcc_string_table_t *table) {\n"
+                "    table->len = 0;\n"
+                "    table->max = 0;\n"
+                "    table->buf = NULL;\n"
+                "}\n"
+                "\n"
+                "static char *pcc_string_table__intern(pcc_context_t *ctx, pcc_string_table_t *table, const char *str, size_t len) {\n"
+                "    size_t i;\n"
+                "    len = strnlen(str, len);\n"
+                "    if (table->max <= table->len * 2) {\n"
+                "        const size_t m = (table->max > 0) ? table->max << 1 : PCC_ARRAY_MIN_SIZE * 4;\n"
+                "        char **const b = (char **)PCC_MALLOC(ctx->auxil, sizeof(char *) * m);\n"
+                "        for (i = 0; i < m; i++) b[i] = NULL;\n"
+                "        for (i = 0; i < table->max; i++) {\n"
+                "            size_t j;\n"
+                "            if (table->buf[i] == NULL) continue;\n"
+                "            for (j = pcc_hash_string(table->buf[i], strlen(table->buf[i])) & (m - 1); b[j] != NULL; j = (j + 1) & (m - 1));\n"
+                "            b[j] = table->buf[i];\n"
+                "        }\n"
+                "        PCC_FREE(ctx->auxil, table->buf);\n"
+                "        ctx->budget.used += sizeof(char *) * (m - table->max);\n"
+                "        table->buf = b;\n"
+                "        table->max = m;\n"
+                "    }\n"
+                "    for (i = pcc_hash_string(str, len) & (table->max - 1); table->buf[i] != NULL; i = (i + 1) & (table->max - 1)) {\n"
+                "        if (strncmp(table->buf[i], str, len) == 0 && table->buf[i][len] == '\\0') return table->buf[i];\n"
+                "    }\n"
+                "    table->buf[i] = pcc_strndup_e(ctx->auxil, str, len);\n"
+                "    table->len++;\n"
+                "    ctx->budget.used += len + 1;\n"
+                "    return table->buf[i];\n"
+                "}\n"
+                "\n"
+                "%svoid pcc_string_table__clear(pcc_context_t *ctx, pcc_string_table_t *table) {\n"
+                "    size_t i;\n"
+                "    for (i = 0; i < table->max; i++) {\n"
+                "        if (table->buf[i] == NULL) continue;\n"
+                "        ctx->budget.used -= strlen(table->buf[i]) + 1;\n"
+                "        PCC_FREE(ctx->auxil, table->buf[i]);\n"
+                "        table->buf[i] = NULL;\n"
+                "    }\n"
+                "    table->len = 0;\n"
+                "}\n"
+                "\n"
+                "static void pcc_string_table__term(pcc_context_t *ctx, pcc_string_table_t *table) {\n"
+                "    pcc_string_table__clear(ctx, table);\n"
+                "    ctx->budget.used -= sizeof(char *) * table->max;\n"
+                "    PCC_FREE(ctx->auxil, table->buf);\n"
+                "}\n"
+                "\n",
+                ac
+            );
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            const char *const z = (ctx->flags & CODE_FLAG__INTERN) ? /* the size of the memory allocated for each node */
+                "(sizeof(int) + sizeof(pcc_range_t) + sizeof(size_t) * 3)" : "(sizeof(int) + sizeof(pcc_range_t) + sizeof(size_t) * 2)";
+            stream__printf(
+                ts,
+                "static void pcc_index_array__init(pcc_auxil_t auxil, pcc_index_array_t *array) {\n"
+                "    array->len = 0;\n"
+                "    array->max = 0;\n"
+                "    array->buf = NULL;\n"
+                "}\n"
+                "\n"
+                "static void pcc_index_array__add(pcc_context_t *ctx, pcc_index_array_t *array, size_t index) {\n"
+                "    if (array->max <= array->len) {\n"
+                "        const size_t n = array->len + 1;\n"
+                "        size_t m = array->max;\n"
+                "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
+                "        while (m < n && m != 0) m <<= 1;\n"
+                "        if (m == 0) m = n;\n"
+                "        array->buf = (size_t *)PCC_REALLOC(ctx->auxil, array->buf, sizeof(size_t) * m);\n"
+                "        ctx->budget.used += sizeof(size_t) * (m - array->max);\n"
+                "        array->max = m;\n"
+                "    }\n"
+                "    array->buf[array->len++] = index;\n"
+                "}\n"
+                "\n"
+                "static void pcc_index_array__term(pcc_context_t *ctx, pcc_index_array_t *array) {\n"
+                "    ctx->budget.used -= sizeof(size_t) * array->max;\n"
+                "    PCC_FREE(ctx->auxil, array->buf);\n"
+                "}\n"
+                "\n"
+                "static void pcc_ast__init(pcc_auxil_t auxil, pcc_ast_t *ast) {\n"
+                "    ast->rules = NULL;\n"
+                "    ast->ranges = NULL;\n"
+                "    ast->firsts = NULL;\n"
+                "    ast->counts = NULL;\n"
+                "%s"
+                "    ast->max = 0;\n"
+                "    ast->len = 0;\n"
+                "    pcc_index_array__init(auxil, &ast->children);\n"
+                "    pcc_index_array__init(auxil, &ast->pending);\n"
+                "    pcc_index_array__init(auxil, &ast->opens);\n"
+                "%s"
+                "}\n"
+                "\n"
+                "%svoid pcc_ast__clear(pcc_auxil_t auxil, pcc_ast_t *ast) {\n"
+                "    ast->len = 0;\n"
+                "    ast->children.len = 0;\n"
+                "    ast->pending.len = 0;\n"
+                "    ast->opens.len = 0;\n"
+                "%s"
+                "}\n"
+                "\n"
+                "%svoid pcc_ast__enter(pcc_context_t *ctx, pcc_ast_t *ast, int rule, size_t start, size_t end) {\n"
+                "    if (ast->max <= ast->len) {\n"
+                "        const size_t n = ast->len + 1;\n"
+                "        size_t m = ast->max;\n"
+                "        if (m == 0) m = PCC_ARRAY_MIN_SIZE;\n"
+                "        while (m < n && m != 0) m <<= 1;\n"
+                "        if (m == 0) m = n;\n"
+                "        ast->rules = (int *)PCC_REALLOC(ctx->auxil, ast->rules, sizeof(int) * m);\n"
+                "        ast->ranges = (pcc_range_t *)PCC_REALLOC(ctx->auxil, ast->ranges, sizeof(pcc_range_t) * m);\n"
+                "        ast->firsts = (size_t *)PCC_REALLOC(ctx->auxil, ast->firsts, sizeof(size_t) * m);\n"
+                "        ast->counts = (size_t *)PCC_REALLOC(ctx->auxil, ast->counts, sizeof(size_t) * m);\n"
+                "%s"
+                "        ctx->budget.used += %s * (m - ast->max);\n"
+                "        ast->max = m;\n"
+                "    }\n"
+                "    ast->rules[ast->len] = rule;\n"
+                "    ast->ranges[ast->len].start = start;\n"
+                "    ast->ranges[ast->len].end = end;\n"
+                "    ast->firsts[ast->len] = ast->pending.len; /* temporarily, the number of the pending nodes */\n"
+                "    ast->counts[ast->len] = 0;\n"
+                "%s"
+                "    pcc_index_array__add(ctx, &ast->opens, ast->len++);\n"
+                "}\n"
+                "\n",
+                (ctx->flags & CODE_FLAG__INTERN) ? "    ast->hashes = NULL;\n" : "",
+                (ctx->flags & CODE_FLAG__INTERN) ? "    pcc_index_array__init(auxil, &ast->slots);\n" : "",
+                ac,
+                (ctx->flags & CODE_FLAG__INTERN) ?
+                    "    for (ast->slots.len = 0; ast->slots.len < ast->slots.max; ast->slots.len++) {\n"
+                    "        ast->slots.buf[ast->slots.len] = PCC_VOID_VALUE;\n"
+                    "    }\n"
+                    "    ast->slots.len = 0; /* the number of the nodes in the hash table */\n" : "",
+                sc,
+                (ctx->flags & CODE_FLAG__INTERN) ? "        ast->hashes = (size_t *)PCC_REALLOC(ctx->auxil, ast->hashes, sizeof(size_t) * m);\n" : "",
+                z,
+                (ctx->flags & CODE_FLAG__INTERN) ? "    ast->hashes[ast->len] = PCC_VOID_VALUE; /* not in the hash table yet */\n" : ""
+            );
+            if (ctx->flags & CODE_FLAG__INTERN) {
+                stream__printf(
+                    ts,
+                    "static pcc_bool_t pcc_ast__is_identical(const pcc_ast_t *ast, const char *buffer, size_t pos, size_t i, size_t j) {\n"
+                    "    /* i: the node being built whose children are pending, j: the node already built, */\n"
+                    "    /* buffer: the input text from the position pos, which the node ranges are relative to */\n"
+                    "    const size_t k = ast->firsts[i];\n"
+                    "    const size_t n = ast->ranges[i].end - ast->ranges[i].start;\n"
+                    "    return (\n"
+                    "        ast->rules[i] == ast->rules[j] &&\n"
+                    "        ast->pending.len - k == ast->counts[j] &&\n"
+                    "        ast->ranges[j].end - ast->ranges[j].start == n &&\n"
+                    "        (ast->counts[j] == 0 || memcmp(ast->pending.buf + k, ast->children.buf + ast->firsts[j], sizeof(size_t) * ast->counts[j]) == 0) &&\n"
+                    "        memcmp(buffer + (ast->ranges[i].start - pos), buffer + (ast->ranges[j].start - pos), n) == 0\n"
+                    "    ) ? PCC_TRUE : PCC_FALSE;\n"
+                    "}\n"
+                    "\n"
+                    "static void pcc_ast__rehash(pcc_context_t *ctx, pcc_ast_t *ast) {\n"
+                    "    const size_t m = (ast->slots.max > 0) ? ast->slots.max << 1 : PCC_ARRAY_MIN_SIZE * 4;\n"
+                    "    size_t i, j;\n"
+                    "    ast->slots.buf = (size_t *)PCC_REALLOC(ctx->auxil, ast->slots.buf, sizeof(size_t) * m);\n"
+                    "    ctx->budget.used += sizeof(size_t) * (m - ast->slots.max);\n"
+                    "    ast->slots.max = m;\n"
+                    "    for (i = 0; i < m; i++) ast->slots.buf[i] = PCC_VOID_VALUE;\n"
+                    "    for (i = 0; i < ast->len; i++) {\n"
+                    "        if (ast->hashes[i] == PCC_VOID_VALUE) continue; /* not in the hash table */\n"
+                    "        for (j = ast->hashes[i] & (m - 1); ast->slots.buf[j] != PCC_VOID_VALUE; j = (j + 1) & (m - 1));\n"
+                    "        ast->slots.buf[j] = i;\n"
+                    "    }\n"
+                    "}\n"
+                    "\n"
+                    "%svoid pcc_ast__leave(pcc_context_t *ctx, pcc_ast_t *ast, const char *buffer, size_t pos) {\n"
+                    "    const size_t i = ast->opens.buf[--ast->opens.len];\n"
+                    "    const size_t k = ast->firsts[i];\n"
+                    "    size_t h = pcc_hash_string(buffer + (ast->ranges[i].start - pos), ast->ranges[i].end - ast->ranges[i].start) ^ (size_t)ast->rules[i];\n"
+                    "    size_t j;\n"
+                    "    for (j = k; j < ast->pending.len; j++) h = (h * 33) ^ ast->pending.buf[j];\n"
+                    "    if (h == PCC_VOID_VALUE) h = 0; /* reserved for the nodes not in the hash table */\n"
+                    "    if (ast->slots.max <= ast->slots.len * 2) pcc_ast__rehash(ctx, ast);\n"
+                    "    for (j = h & (ast->slots.max - 1); ast->slots.buf[j] != PCC_VOID_VALUE; j = (j + 1) & (ast->slots.max - 1)) {\n"
+                    "        const size_t e = ast->slots.buf[j];\n"
+                    "        if (ast->hashes[e] == h && i + 1 == ast->len && pcc_ast__is_identical(ast, buffer, pos, i, e)) { /* shares the identical subtree */\n"
+                    "            ast->len--;\n"
+                    "            ast->pending.len = k;\n"
+                    "            pcc_index_array__add(ctx, &ast->pending, e);\n"
+                    "            return;\n"
+                    "        }\n"
+                    "    }\n"
+                    "    ast->slots.buf[j] = i;\n"
+                    "    ast->slots.len++;\n"
+                    "    ast->hashes[i] = h;\n"
+                    "    ast->firsts[i] = ast->children.len;\n"
+                    "    ast->counts[i] = ast->pending.len - k;\n"
+                    "    for (j = k; j < ast->pending.len; j++) {\n"
+                    "        pcc_index_array__add(ctx, &ast->children, ast->pending.buf[j]);\n"
+                    "    }\n"
+                    "    ast->pending.len = k;\n"
+                    "    pcc_index_array__add(ctx, &ast->pending, i);\n"
+                    "}\n"
+                    "\n",
+                    sc
+                );
+            }
+            else {
+                stream__printf(
+                    ts,
+                    "%svoid pcc_ast__leave(pcc_context_t *ctx, pcc_ast_t *ast) {\n"
+                    "    const size_t i = ast->opens.buf[--ast->opens.len];\n"
+                    "    const size_t k = ast->firsts[i];\n"
+                    "    size_t j;\n"
+                    "    ast->firsts[i] = ast->children.len;\n"
+                    "    ast->counts[i] = ast->pending.len - k;\n"
+                    "    for (j = k; j < ast->pending.len; j++) {\n"
+                    "        pcc_index_array__add(ctx, &ast->children, ast->pending.buf[j]);\n"
+                    "    }\n"
+                    "    ast->pending.len = k;\n"
+                    "    pcc_index_array__add(ctx, &ast->pending, i);\n"
+                    "}\n"
+                    "\n",
+                    sc
+                );
+            }
+            stream__printf(
+                ts,
+                "static void pcc_ast__term(pcc_context_t *ctx, pcc_ast_t *ast) {\n"
+                "%s"
+                "    pcc_index_array__term(ctx, &ast->opens);\n"
+                "    pcc_index_array__term(ctx, &ast->pending);\n"
+                "    pcc_index_array__term(ctx, &ast->children);\n"
+                "%s"
+                "    PCC_FREE(ctx->auxil, ast->counts);\n"
+                "    PCC_FREE(ctx->auxil, ast->firsts);\n"
+                "    PCC_FREE(ctx->auxil, ast->ranges);\n"
+                "    PCC_FREE(ctx->auxil, ast->rules);\n"
+                "    ctx->budget.used -= %s * ast->max;\n"
+                "}\n"
+                "\n",
+                (ctx->flags & CODE_FLAG__INTERN) ? "    pcc_index_array__term(ctx, &ast->slots);\n" : "",
+                (ctx->flags & CODE_FLAG__INTERN) ? "    PCC_FREE(ctx->auxil, ast->hashes);\n" : "",
+                z
+            );
+        }
+        stream__printf(
+            ts,
+            "%spcc_context_t *pcc_context__create(pcc_auxil_t auxil%s) {\n"
             "    pcc_context_t *const ctx = (pcc_context_t *)PCC_MALLOC(auxil, sizeof(pcc_context_t));\n"
             "    ctx->pos = 0;\n"
             "    ctx->cur = 0;\n"
             "    ctx->level = 0;\n"
+            "    ctx->depth_limit = PCC_VOID_VALUE;\n"
+            "    ctx->status = 0;\n"
+            "    ctx->steps = 0;\n"
+            "    ctx->step_limit = PCC_VOID_VALUE;\n"
+            "    ctx->budget.used = 0;\n"
+            "    ctx->budget.limit = 0;\n"
+            "    ctx->budget.margin = PCC_VOID_VALUE;\n"
+            "    ctx->budget.saving = PCC_FALSE;\n"
+            "%s%s"
             "    pcc_char_array__init(auxil, &ctx->buffer);\n"
             "    pcc_lr_table__init(auxil, &ctx->lrtable);\n"
             "    pcc_lr_stack__init(auxil, &ctx->lrstack);\n"
-            "    pcc_thunk_array__init(auxil, &ctx->thunks);\n"
-            "    pcc_memory_recycler__init(auxil, &ctx->thunk_chunk_recycler, sizeof(pcc_thunk_chunk_t));\n"
-            "    pcc_memory_recycler__init(auxil, &ctx->lr_head_recycler, sizeof(pcc_lr_head_t));\n"
-            "    pcc_memory_recycler__init(auxil, &ctx->lr_answer_recycler, sizeof(pcc_lr_answer_t));\n"
+            "    pcc_thunk_stack__init(auxil, &ctx->thunkstack);\n"
+            "    pcc_thunk_array__init(ctx, &ctx->thunks);\n"
+            "    ctx->void_chunk.values = NULL;\n"
+            "    ctx->void_chunk.capts = NULL;\n"
+            "    ctx->void_chunk.valuec = 0;\n"
+            "    ctx->void_chunk.captc = 0;\n"
+            "    pcc_thunk_array__init(ctx, &ctx->void_chunk.thunks);\n"
+            "    ctx->void_chunk.pos = 0;\n"
+            "    ctx->void_chunk.recycler = NULL;\n"
+            "    ctx->void_chunk.evaluated = PCC_FALSE;\n",
+            ac, (rt != NULL) ? ", const pcc_hooks_t *hooks" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "    memset(&ctx->stats, 0, sizeof(pcc_stats_t));\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "    pcc_arena__init(auxil, &ctx->arena);\n" : ""
+        );
+        if (ctx->flags & CODE_FLAG__INTERN) {
+            stream__puts(
+                ts,
+                "    pcc_string_table__init(auxil, &ctx->strings);\n"
+            );
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            stream__puts(
+                ts,
+                "    pcc_ast__init(auxil, &ctx->ast);\n"
+            );
+        }
+        if (ctx->flags & CODE_FLAG__EVENT) {
+            stream__puts(
+                ts,
+                "    ctx->void_chunk.events.array = NULL;\n"
+                "    pcc_event_log__init(auxil, &ctx->events);\n"
+            );
+        }
+        if (rt != NULL) {
+            stream__puts(
+                ts,
+                "    {\n"
+                "        size_t i;\n"
+                "        ctx->hooks = hooks;\n"
+                "        ctx->thunk_chunk_recyclers = (pcc_memory_recycler_t *)PCC_MALLOC(auxil, sizeof(pcc_memory_recycler_t) * hooks->layoutc);\n"
+                "        for (i = 0; i < hooks->layoutc; i++) {\n"
+                "            pcc_memory_recycler__init(\n"
+                "                ctx, &ctx->thunk_chunk_recyclers[i], pcc_thunk_chunk__size(hooks->layouts[i * 2], hooks->layouts[i * 2 + 1])\n"
+                "            );\n"
+                "        }\n"
+                "    }\n"
+            );
+        }
+        else if (layouts > 0) {
+            size_t i, k = 0;
+            for (i = 0; i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                if (r->layout != k) continue; /* not the first rule with the layout */
+                stream__printf(
+                    ts,
+                    "    pcc_memory_recycler__init(ctx, &ctx->thunk_chunk_recyclers[" FMT_LU "], pcc_thunk_chunk__size(" FMT_LU ", " FMT_LU "));\n",
+                    (ulong_t)k, (ulong_t)r->vars.len, (ulong_t)r->capts.len
+                );
+                k++;
+            }
+        }
+        else {
+            stream__puts(
+                ts,
+                "    pcc_memory_recycler__init(ctx, &ctx->thunk_chunk_recyclers[0], pcc_thunk_chunk__size(0, 0));\n"
+            );
+        }
+        stream__puts(
+            ts,
+            "    pcc_memory_recycler__init(ctx, &ctx->lr_head_recycler, sizeof(pcc_lr_head_t));\n"
+            "    pcc_memory_recycler__init(ctx, &ctx->lr_answer_recycler, sizeof(pcc_lr_answer_t));\n"
             "    ctx->auxil = auxil;\n"
             "    return ctx;\n"
             "}\n"
             "\n"
         );
-        stream__puts(
-            &sstream,
-            "static void pcc_context__destroy(pcc_context_t *ctx) {\n"
+        stream__printf(
+            ts,
+            "%svoid pcc_context__destroy(pcc_context_t *ctx) {\n"
+            "    size_t i;\n"
             "    if (ctx == NULL) return;\n"
-            "    pcc_thunk_array__term(ctx->auxil, &ctx->thunks);\n"
+            "%s"
+            "    pcc_thunk_array__term(ctx, &ctx->thunks);\n"
+            "    pcc_thunk_stack__term(ctx->auxil, &ctx->thunkstack);\n"
             "    pcc_lr_stack__term(ctx->auxil, &ctx->lrstack);\n"
             "    pcc_lr_table__term(ctx, &ctx->lrtable);\n"
             "    pcc_char_array__term(ctx->auxil, &ctx->buffer);\n"
-            "    pcc_memory_recycler__term(ctx->auxil, &ctx->thunk_chunk_recycler);\n"
-            "    pcc_memory_recycler__term(ctx->auxil, &ctx->lr_head_recycler);\n"
-            "    pcc_memory_recycler__term(ctx->auxil, &ctx->lr_answer_recycler);\n"
+            "    for (i = 0; i < %s; i++) {\n"
+            "        pcc_memory_recycler__term(ctx, &ctx->thunk_chunk_recyclers[i]);\n"
+            "    }\n"
+            "%s"
+            "    pcc_memory_recycler__term(ctx, &ctx->lr_head_recycler);\n"
+            "    pcc_memory_recycler__term(ctx, &ctx->lr_answer_recycler);\n"
+            "%s%s%s"
             "    PCC_FREE(ctx->auxil, ctx);\n"
             "}\n"
+            "\n",
+            ac,
+            (ctx->flags & CODE_FLAG__AST) ? "    pcc_ast__term(ctx, &ctx->ast);\n" : "",
+            nl,
+            (rt != NULL) ? "    PCC_FREE(ctx->auxil, ctx->thunk_chunk_recyclers);\n" : "",
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__term(ctx, &ctx->events);\n" : "",
+            (ctx->flags & CODE_FLAG__INTERN) ? "    pcc_string_table__term(ctx, &ctx->strings);\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "    pcc_arena__term(ctx->auxil, &ctx->arena);\n" : ""
+        );
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__printf(
+                ts,
+                "%svoid pcc_context__release(pcc_context_t *ctx) {\n"
+                "    /* releases all the memory allocated from the arena in the parsing at once; */\n"
+                "    /* the memos referring to it have been discarded by pcc_commit_buffer() */\n"
+                "    const size_t n = pcc_arena__size(ctx->auxil, &ctx->arena);\n"
+                "    size_t i;\n"
+                "    pcc_thunk_array__init(ctx, &ctx->thunks);\n"
+                "    pcc_thunk_array__init(ctx, &ctx->void_chunk.thunks);\n"
+                "    for (i = 0; i < %s; i++) {\n"
+                "        pcc_memory_recycler__term(ctx, &ctx->thunk_chunk_recyclers[i]);\n"
+                "    }\n"
+                "    pcc_memory_recycler__term(ctx, &ctx->lr_head_recycler);\n"
+                "    pcc_memory_recycler__term(ctx, &ctx->lr_answer_recycler);\n"
+                "    pcc_arena__reset(ctx->auxil, &ctx->arena);\n"
+                "    ctx->budget.used -= n - pcc_arena__size(ctx->auxil, &ctx->arena);\n"
+                "}\n"
+                "\n",
+                ac, nl
+            );
+        }
+        stream__printf(
+            ts,
+            "static size_t pcc_context__retained_size(pcc_context_t *ctx) {\n"
+            "    size_t n = ctx->buffer.max;\n"
+            "    size_t i;\n"
+            "    n += sizeof(pcc_lr_table_entry_t *) * ctx->lrtable.max;\n"
+            "    n += sizeof(pcc_lr_entry_t *) * ctx->lrstack.max;\n"
+            "    n += sizeof(pcc_thunk_frame_t) * ctx->thunkstack.max;\n"
+            "    n += sizeof(pcc_thunk_t) * ctx->thunks.max;\n"
+            "    for (i = 0; i < %s; i++) {\n"
+            "        n += pcc_memory_recycler__size(ctx, &ctx->thunk_chunk_recyclers[i]);\n"
+            "    }\n"
+            "    n += pcc_memory_recycler__size(ctx, &ctx->lr_head_recycler);\n"
+            "    n += pcc_memory_recycler__size(ctx, &ctx->lr_answer_recycler);\n"
+            "%s%s"
+            "    return n;\n"
+            "}\n"
             "\n"
+            "%svoid pcc_context__trim(pcc_context_t *ctx) {\n"
+            "    /* releases the memory kept for reuse, except the memory holding the buffered input or the results */\n"
+            "    size_t i;\n"
+            "    pcc_lr_table__term(ctx, &ctx->lrtable);\n"
+            "    pcc_lr_table__init(ctx->auxil, &ctx->lrtable);\n"
+            "    pcc_lr_stack__term(ctx->auxil, &ctx->lrstack);\n"
+            "    pcc_lr_stack__init(ctx->auxil, &ctx->lrstack);\n"
+            "    pcc_thunk_stack__term(ctx->auxil, &ctx->thunkstack);\n"
+            "    pcc_thunk_stack__init(ctx->auxil, &ctx->thunkstack);\n"
+            "    pcc_thunk_array__term(ctx, &ctx->thunks);\n"
+            "    pcc_thunk_array__init(ctx, &ctx->thunks);\n"
+            "    for (i = 0; i < %s; i++) {\n"
+            "        pcc_memory_recycler__term(ctx, &ctx->thunk_chunk_recyclers[i]);\n"
+            "    }\n"
+            "    pcc_memory_recycler__term(ctx, &ctx->lr_head_recycler);\n"
+            "    pcc_memory_recycler__term(ctx, &ctx->lr_answer_recycler);\n"
+            "    if (ctx->buffer.len == 0) {\n"
+            "        ctx->budget.used -= ctx->buffer.max;\n"
+            "        pcc_char_array__term(ctx->auxil, &ctx->buffer);\n"
+            "        pcc_char_array__init(ctx->auxil, &ctx->buffer);\n"
+            "    }\n"
+            "%s%s%s%s"
+            "}\n"
+            "\n",
+            nl,
+            (ctx->flags & CODE_FLAG__EVENT) ?
+                "    n += sizeof(pcc_event_t) * (ctx->events.pending.max + ctx->events.stash.max);\n"
+                "    n += sizeof(pcc_thunk_chunk_t *) * (ctx->events.held.max + ctx->events.stashed.max);\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "    n += pcc_arena__size(ctx->auxil, &ctx->arena);\n" : "",
+            ac, nl,
+            (ctx->flags & CODE_FLAG__EVENT) ?
+                "    pcc_event_log__term(ctx, &ctx->events);\n"
+                "    pcc_event_log__init(ctx->auxil, &ctx->events);\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ?
+                "    ctx->budget.used -= pcc_arena__size(ctx->auxil, &ctx->arena);\n"
+                "    pcc_arena__trim(ctx->auxil, &ctx->arena);\n" : "",
+            (ctx->flags & CODE_FLAG__AST) ?
+                "    if (ctx->ast.len == 0) {\n"
+                "        pcc_ast__term(ctx, &ctx->ast);\n"
+                "        pcc_ast__init(ctx->auxil, &ctx->ast);\n"
+                "    }\n" : "",
+            (ctx->flags & CODE_FLAG__INTERN) ?
+                "    if (ctx->strings.len == 0) {\n"
+                "        pcc_string_table__term(ctx, &ctx->strings);\n"
+                "        pcc_string_table__init(ctx->auxil, &ctx->strings);\n"
+                "    }\n" : ""
         );
-        stream__puts(
-            &sstream,
-            "static size_t pcc_refill_buffer(pcc_context_t *ctx, size_t num) {\n"
+        stream__printf(
+            ts,
+            "%svoid pcc_context__reset(pcc_context_t *ctx, pcc_auxil_t auxil) {\n"
+            "    /* discards the buffered input and whatever the previous parsing left, even if it was interrupted, */\n"
+            "    /* keeping the memory allocated for reuse unless more than PCC_RETAIN_MAX_SIZE bytes are kept */\n"
+            "    pcc_lr_table__shift(ctx, &ctx->lrtable, ctx->lrtable.len);\n"
+            "    ctx->lrtable.ofs = 0;\n"
+            "    ctx->lrtable.len = 0;\n"
+            "    ctx->lrstack.len = 0;\n"
+            "    ctx->thunkstack.len = 0;\n"
+            "    pcc_thunk_array__revert(ctx, &ctx->thunks, 0);\n"
+            "    pcc_thunk_array__revert(ctx, &ctx->void_chunk.thunks, 0);\n"
+            "%s%s%s%s"
+            "    ctx->buffer.len = 0;\n"
+            "    ctx->pos = 0;\n"
+            "    ctx->cur = 0;\n"
+            "    ctx->level = 0;\n"
+            "    ctx->status = 0;\n"
+            "    ctx->steps = 0;\n"
+            "    ctx->budget.saving = PCC_FALSE;\n"
+            "    ctx->auxil = auxil;\n"
+            "    if (pcc_context__retained_size(ctx) > PCC_RETAIN_MAX_SIZE) pcc_context__trim(ctx);\n"
+            "%s"
+            "}\n"
+            "\n",
+            ac,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__clear(&ctx->events);\n" : "",
+            (ctx->flags & CODE_FLAG__ARENA) ? "    pcc_context__release(ctx);\n" : "",
+            (ctx->flags & CODE_FLAG__AST) ? "    pcc_ast__clear(ctx->auxil, &ctx->ast);\n" : "",
+            (ctx->flags & CODE_FLAG__INTERN) ? "    pcc_string_table__clear(ctx, &ctx->strings);\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ?
+                "    ctx->stats.memo_hits = 0;\n"
+                "    ctx->stats.memo_misses = 0;\n"
+                "    ctx->stats.memos_peak = ctx->stats.memos;\n"
+                "    ctx->stats.thunks_peak = ctx->stats.thunks;\n"
+                "    ctx->stats.chunks_peak = ctx->stats.chunks;\n"
+                "    ctx->stats.memory_peak_bytes = ctx->budget.used;\n" : ""
+        );
+        stream__printf(
+            ts,
+            "%ssize_t pcc_refill_buffer(pcc_context_t *ctx, size_t num) {\n"
+            "    size_t m;\n"
             "    if (ctx->buffer.len >= ctx->cur + num) return ctx->buffer.len - ctx->cur;\n"
+            "    if (ctx->status != 0) return 0; /* no more input is read after an error */\n"
+            "    m = ctx->buffer.max;\n"
             "    while (ctx->buffer.len < ctx->cur + num) {\n"
             "        const int c = PCC_GETCHAR(ctx->auxil);\n"
             "        if (c < 0) break;\n"
             "        pcc_char_array__add(ctx->auxil, &ctx->buffer, (char)c);\n"
             "    }\n"
+            "    ctx->budget.used += ctx->buffer.max - m;\n"
             "    return ctx->buffer.len - ctx->cur;\n"
             "}\n"
-            "\n"
+            "\n",
+            sc
         );
-        stream__puts(
-            &sstream,
+        {
+            char *const q = strdup_e(rp);
+            make_header_identifier(q);
+            stream__printf(
+                ts,
+                "static void pcc_context__save_memory(pcc_context_t *ctx) {\n"
+                "    /* called if the memory usage exceeds the margin below the limit */\n"
+                "    size_t i;\n"
+                "    if (!ctx->budget.saving) {\n"
+                "        ctx->budget.saving = PCC_TRUE; /* stops keeping the memos of the failed rules */\n"
+                "        for (i = 0; i < ctx->lrtable.len - ctx->lrtable.ofs; i++) pcc_lr_table__forget_failures(ctx, &ctx->lrtable, i);\n"
+                "    }\n"
+                "    if (ctx->budget.used > ctx->budget.limit) ctx->status = %s_STATUS_MEMORY_LIMIT;\n"
+                "}\n"
+                "\n"
+                "static pcc_bool_t pcc_context__can_continue(pcc_context_t *ctx) {\n"
+                "    if (ctx->status != 0) return PCC_FALSE;\n"
+                "%s"
+                "    if (ctx->budget.used > ctx->budget.margin) pcc_context__save_memory(ctx);\n"
+                "    if (ctx->status == 0 && ++ctx->steps > ctx->step_limit) ctx->status = %s_STATUS_STEP_LIMIT;\n"
+                "    if (ctx->status == 0 && ctx->level >= ctx->depth_limit) ctx->status = %s_STATUS_DEPTH_LIMIT;\n"
+                "    if (ctx->status == 0 && PCC_CANCELED(ctx->auxil)) ctx->status = %s_STATUS_CANCELED;\n"
+                "    return (ctx->status == 0) ? PCC_TRUE : PCC_FALSE;\n"
+                "}\n"
+                "\n",
+                q,
+                (ctx->flags & CODE_FLAG__STATS) ?
+                    "    if (ctx->budget.used > ctx->stats.memory_peak_bytes) ctx->stats.memory_peak_bytes = ctx->budget.used;\n" : "",
+                q, q, q
+            );
+            free(q);
+        }
+        stream__printf(
+            ts,
             "MARK_FUNC_AS_USED\n"
-            "static void pcc_commit_buffer(pcc_context_t *ctx) {\n"
-            "    memmove(ctx->buffer.buf, ctx->buffer.buf + ctx->cur, ctx->buffer.len - ctx->cur);\n"
+            "%svoid pcc_commit_buffer(pcc_context_t *ctx) {\n"
+            "    if (ctx->buffer.len > ctx->cur) memmove(ctx->buffer.buf, ctx->buffer.buf + ctx->cur, ctx->buffer.len - ctx->cur);\n"
             "    ctx->buffer.len -= ctx->cur;\n"
             "    ctx->pos += ctx->cur;\n"
-            "    pcc_lr_table__shift(ctx, &ctx->lrtable, ctx->cur);\n"
+            "    pcc_lr_table__shift(ctx, &ctx->lrtable, ctx->lrtable.len); /* the memos ahead refer to the characters being moved */\n"
+            "%s"
             "    ctx->cur = 0;\n"
             "}\n"
-            "\n"
+            "\n",
+            ac,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__clear(&ctx->events); /* so do the events not delivered */\n" : ""
         );
-        stream__puts(
-            &sstream,
+        stream__printf(
+            ts,
             "MARK_FUNC_AS_USED\n"
-            "static const char *pcc_get_capture_string(pcc_context_t *ctx, const pcc_capture_t *capt) {\n"
+            "%sconst char *pcc_get_capture_string(pcc_context_t *ctx, const pcc_capture_t *capt) {\n"
             "    if (capt->string == NULL)\n"
             "        ((pcc_capture_t *)capt)->string =\n"
-            "            pcc_strndup_e(ctx->auxil, ctx->buffer.buf + capt->range.start, capt->range.end - capt->range.start);\n"
+            "            %sctx->buffer.buf + capt->range.start, capt->range.end - capt->range.start);\n"
             "    return capt->string;\n"
             "}\n"
-            "\n"
+            "\n",
+            sc,
+            (ctx->flags & CODE_FLAG__INTERN) ? "pcc_string_table__intern(ctx, &ctx->strings, " :
+            (ctx->flags & CODE_FLAG__ARENA) ? "pcc_arena__strndup(ctx, " : "pcc_strndup_e(ctx->auxil, "
         );
-        if (ctx->flags & CODE_FLAG__UTF8_CHARCLASS_USED) {
-            stream__puts(
-                &sstream,
-                "static size_t pcc_get_char_as_utf32(pcc_context_t *ctx, int *out) { /* with checking UTF-8 validity */\n"
+        if (rt != NULL || (ctx->flags & CODE_FLAG__UTF8_CHARCLASS_USED)) {
+            stream__printf(
+                ts,
+                "%ssize_t pcc_get_char_as_utf32(pcc_context_t *ctx, int *out) { /* with checking UTF-8 validity */\n"
                 "    int c, u;\n"
                 "    size_t n;\n"
                 "    if (pcc_refill_buffer(ctx, 1) < 1) return 0;\n"
                 "    c = (int)(unsigned char)ctx->buffer.buf[ctx->cur];\n"
-                "    n = (c < 0x80) ? 1 :\n"
-                "        ((c & 0xe0) == 0xc0) ? 2 :\n"
+                "    if (c < 0x80) { /* fast path for ASCII characters */\n"
+                "        if (out) *out = c;\n"
+                "        return 1;\n"
+                "    }\n"
+                "    n = ((c & 0xe0) == 0xc0) ? 2 :\n"
                 "        ((c & 0xf0) == 0xe0) ? 3 :\n"
                 "        ((c & 0xf8) == 0xf0) ? 4 : 0;\n"
                 "    if (n < 1) return 0;\n"
                 "    if (pcc_refill_buffer(ctx, n) < n) return 0;\n"
                 "    switch (n) {\n"
-                "    case 1:\n"
-                "        u = c;\n"
-                "        break;\n"
                 "    case 2:\n"
                 "        u = c & 0x1f;\n"
                 "        c = (int)(unsigned char)ctx->buffer.buf[ctx->cur + 1];\n"
@@ -4435,40 +7913,46 @@ static bool_t generate(context_t *ctx) {
                 "    if (out) *out = u;\n"
                 "    return n;\n"
                 "}\n"
-                "\n"
+                "\n",
+                sc
             );
         }
-        stream__puts(
-            &sstream,
+        stream__printf(
+            ts,
             "MARK_FUNC_AS_USED\n"
-            "static pcc_bool_t pcc_apply_rule(pcc_context_t *ctx, pcc_rule_t rule, pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
-            "    static pcc_value_t null;\n"
+            "%spcc_bool_t pcc_apply_rule(pcc_context_t *ctx, pcc_rule_t rule, pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
             "    pcc_thunk_chunk_t *c = NULL;\n"
             "    const size_t p = ctx->pos + ctx->cur;\n"
             "    pcc_bool_t b = PCC_TRUE;\n"
-            "    pcc_lr_answer_t *a = pcc_lr_table__get_answer(ctx, &ctx->lrtable, p, rule);\n"
-            "    pcc_lr_head_t *h = pcc_lr_table__get_head(ctx, &ctx->lrtable, p);\n"
+            "    pcc_lr_answer_t *a;\n"
+            "    pcc_lr_head_t *h;\n"
+            "%s"
+            "    if (!pcc_context__can_continue(ctx)) return PCC_FALSE; /* unwinds the parsing */\n"
+            "    a = pcc_lr_table__get_answer(ctx, &ctx->lrtable, p - ctx->pos, rule);\n"
+            "    h = pcc_lr_table__get_head(ctx, &ctx->lrtable, p - ctx->pos);\n"
             "    if (h != NULL) {\n"
-            "        if (a == NULL && rule != h->rule && pcc_rule_set__index(ctx->auxil, &h->invol, rule) == PCC_VOID_VALUE) {\n"
+            "        if (a == NULL && rule != h->rule && pcc_rule_set__index(ctx, &h->invol, rule) == PCC_VOID_VALUE) {\n"
             "            b = PCC_FALSE;\n"
             "            c = NULL;\n"
             "        }\n"
-            "        else if (pcc_rule_set__remove(ctx->auxil, &h->eval, rule)) {\n"
+            "        else if (pcc_rule_set__remove(ctx, &h->eval, rule)) {\n"
             "            b = PCC_FALSE;\n"
+            "%s"
             "            c = rule(ctx);\n"
             "            a = pcc_lr_answer__create(ctx, PCC_LR_ANSWER_CHUNK, ctx->pos + ctx->cur);\n"
             "            a->data.chunk = c;\n"
-            "            pcc_lr_table__hold_answer(ctx, &ctx->lrtable, p, a);\n"
+            "            pcc_lr_table__hold_answer(ctx, &ctx->lrtable, p - ctx->pos, a);\n"
             "        }\n"
             "    }\n"
             "    if (b) {\n"
             "        if (a != NULL) {\n"
+            "%s"
             "            ctx->cur = a->pos - ctx->pos;\n"
             "            switch (a->type) {\n"
             "            case PCC_LR_ANSWER_LR:\n"
             "                if (a->data.lr->head == NULL) {\n"
             "                    a->data.lr->head = pcc_lr_head__create(ctx, rule);\n"
-            "                    pcc_lr_table__hold_head(ctx, &ctx->lrtable, p, a->data.lr->head);\n"
+            "                    pcc_lr_table__hold_head(ctx, &ctx->lrtable, p - ctx->pos, a->data.lr->head);\n"
             "                }\n"
             "                {\n"
             "                    size_t i = ctx->lrstack.len;\n"
@@ -4476,7 +7960,7 @@ static bool_t generate(context_t *ctx) {
             "                        i--;\n"
             "                        if (ctx->lrstack.buf[i]->head == a->data.lr->head) break;\n"
             "                        ctx->lrstack.buf[i]->head = a->data.lr->head;\n"
-            "                        pcc_rule_set__add(ctx->auxil, &a->data.lr->head->invol, ctx->lrstack.buf[i]->rule);\n"
+            "                        pcc_rule_set__add(ctx, &a->data.lr->head->invol, ctx->lrstack.buf[i]->rule);\n"
             "                    }\n"
             "                }\n"
             "                c = a->data.lr->seed;\n"
@@ -4489,16 +7973,18 @@ static bool_t generate(context_t *ctx) {
             "            }\n"
             "        }\n"
             "        else {\n"
-            "            pcc_lr_entry_t *const e = pcc_lr_entry__create(ctx->auxil, rule);\n"
+            "            pcc_lr_entry_t *const e = pcc_lr_entry__create(ctx, rule);\n"
+            "%s"
             "            pcc_lr_stack__push(ctx->auxil, &ctx->lrstack, e);\n"
             "            a = pcc_lr_answer__create(ctx, PCC_LR_ANSWER_LR, p);\n"
             "            a->data.lr = e;\n"
-            "            pcc_lr_table__set_answer(ctx, &ctx->lrtable, p, rule, a);\n"
+            "            pcc_lr_table__set_answer(ctx, &ctx->lrtable, p - ctx->pos, rule, a);\n"
             "            c = rule(ctx);\n"
             "            pcc_lr_stack__pop(ctx->auxil, &ctx->lrstack);\n"
             "            a->pos = ctx->pos + ctx->cur;\n"
             "            if (e->head == NULL) {\n"
             "                pcc_lr_answer__set_chunk(ctx, a, c);\n"
+            "                if (c == NULL && ctx->budget.saving) pcc_lr_table__forget_failures(ctx, &ctx->lrtable, p - ctx->pos);\n"
             "            }\n"
             "            else {\n"
             "                e->seed = c;\n"
@@ -4507,7 +7993,7 @@ static bool_t generate(context_t *ctx) {
             "                    c = a->data.lr->seed;\n"
             "                    a = pcc_lr_answer__create(ctx, PCC_LR_ANSWER_CHUNK, ctx->pos + ctx->cur);\n"
             "                    a->data.chunk = c;\n"
-            "                    pcc_lr_table__hold_answer(ctx, &ctx->lrtable, p, a);\n"
+            "                    pcc_lr_table__hold_answer(ctx, &ctx->lrtable, p - ctx->pos, a);\n"
             "                }\n"
             "                else {\n"
             "                    pcc_lr_answer__set_chunk(ctx, a, a->data.lr->seed);\n"
@@ -4515,17 +8001,17 @@ static bool_t generate(context_t *ctx) {
             "                        c = NULL;\n"
             "                    }\n"
             "                    else {\n"
-            "                        pcc_lr_table__set_head(ctx, &ctx->lrtable, p, h);\n"
+            "                        pcc_lr_table__set_head(ctx, &ctx->lrtable, p - ctx->pos, h);\n"
             "                        for (;;) {\n"
             "                            ctx->cur = p - ctx->pos;\n"
-            "                            pcc_rule_set__copy(ctx->auxil, &h->eval, &h->invol);\n"
+            "                            pcc_rule_set__copy(ctx, &h->eval, &h->invol);\n"
             "                            c = rule(ctx);\n"
             "                            if (c == NULL || ctx->pos + ctx->cur <= a->pos) break;\n"
             "                            pcc_lr_answer__set_chunk(ctx, a, c);\n"
             "                            a->pos = ctx->pos + ctx->cur;\n"
             "                        }\n"
             "                        pcc_thunk_chunk__destroy(ctx, c);\n"
-            "                        pcc_lr_table__set_head(ctx, &ctx->lrtable, p, NULL);\n"
+            "                        pcc_lr_table__set_head(ctx, &ctx->lrtable, p - ctx->pos, NULL);\n"
             "                        ctx->cur = a->pos - ctx->pos;\n"
             "                        c = a->data.chunk;\n"
             "                    }\n"
@@ -4534,38 +8020,72 @@ static bool_t generate(context_t *ctx) {
             "        }\n"
             "    }\n"
             "    if (c == NULL) return PCC_FALSE;\n"
-            "    if (value == NULL) value = &null;\n"
-            "    memset(value, 0, sizeof(pcc_value_t)); /* in case */\n"
-            "    pcc_thunk_array__add(ctx->auxil, thunks, pcc_thunk__create_node(ctx->auxil, &c->thunks, value));\n"
+            "%s"
+            "    if (c->evaluated) {\n"
+            "        if (value != NULL) pcc_thunk_array__add_node(ctx, thunks, NULL, value, &c->value);\n"
+            "    }\n"
+            "    else if (c->thunks.len > 0)\n"
+            "        pcc_thunk_array__add_node(ctx, thunks, &c->thunks, value, NULL);\n"
             "    return PCC_TRUE;\n"
             "}\n"
-            "\n"
+            "\n",
+            sc,
+            (ctx->flags & CODE_FLAG__EVENT) ? "    const size_t m = ctx->events.base + ctx->events.pending.len; /* the mark of the events of the rule */\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "            ctx->stats.memo_misses++;\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "            ctx->stats.memo_hits++;\n" : "",
+            (ctx->flags & CODE_FLAG__STATS) ? "            ctx->stats.memo_misses++;\n" : "",
+            (ctx->flags & CODE_FLAG__EVENT) ?
+                "    if (thunks != NULL)\n"
+                "        pcc_event_log__settle(ctx, &ctx->events, c, m); /* replays the events of the memo if not pending */\n"
+                "    else\n"
+                "        pcc_event_log__revert(ctx, &ctx->events, m); /* the rules applied by the skipper deliver no events */\n" : ""
         );
-        stream__puts(
-            &sstream,
+        stream__printf(
+            ts,
             "MARK_FUNC_AS_USED\n"
-            "static void pcc_do_action(pcc_context_t *ctx, const pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
-            "    size_t i;\n"
-            "    for (i = 0; i < thunks->len; i++) {\n"
-            "        pcc_thunk_t *const thunk = thunks->buf[i];\n"
-            "        switch (thunk->type) {\n"
-            "        case PCC_THUNK_LEAF:\n"
-            "            thunk->data.leaf.action(ctx, thunk, value);\n"
-            "            break;\n"
-            "        case PCC_THUNK_NODE:\n"
-            "            pcc_do_action(ctx, thunk->data.node.thunks, thunk->data.node.value);\n"
-            "            break;\n"
-            "        default: /* unknown */\n"
-            "            break;\n"
+            "%svoid pcc_do_action(pcc_context_t *ctx, const pcc_thunk_array_t *thunks, pcc_value_t *value) {\n"
+            "    pcc_thunk_stack_t *const stack = &ctx->thunkstack;\n"
+            "    const size_t base = stack->len; /* the frames of an outer evaluation, if any, are kept */\n"
+            "    if (value != NULL) PCC_VALUE_INIT(ctx->auxil, value);\n"
+            "    pcc_thunk_stack__push(ctx, stack, thunks, value);\n"
+            "    while (stack->len > base) { /* evaluates the thunks in the same order as the depth-first traversal */\n"
+            "        pcc_thunk_frame_t *const frame = &stack->buf[stack->len - 1];\n"
+            "        if (frame->index >= frame->thunks->len) {\n"
+            "            if (frame->value == NULL) PCC_VALUE_DESTROY(ctx->auxil, &frame->scratch);\n"
+            "            stack->len--;\n"
+            "            continue;\n"
+            "        }\n"
+            "        {\n"
+            "            pcc_thunk_t *const thunk = &frame->thunks->buf[frame->index++];\n"
+            "            switch (thunk->type) {\n"
+            "            case PCC_THUNK_LEAF:\n"
+            "                thunk->data.leaf.action(ctx, thunk, (frame->value != NULL) ? frame->value : &frame->scratch);\n"
+            "                break;\n"
+            "            case PCC_THUNK_NODE:\n"
+            "                if (thunk->data.node.value != NULL) { /* the value computed previously, if any, is discarded */\n"
+            "                    PCC_VALUE_DESTROY(ctx->auxil, thunk->data.node.value);\n"
+            "                    PCC_VALUE_INIT(ctx->auxil, thunk->data.node.value);\n"
+            "                }\n"
+            "                if (thunk->data.node.thunks == NULL) { /* evaluated eagerly */\n"
+            "                    PCC_VALUE_MOVE(ctx->auxil, thunk->data.node.value, thunk->data.node.source);\n"
+            "                    break;\n"
+            "                }\n"
+            "                pcc_thunk_stack__push(ctx, stack, thunk->data.node.thunks, thunk->data.node.value);\n"
+            "                break;\n"
+            "            default: /* unknown */\n"
+            "                break;\n"
+            "            }\n"
             "        }\n"
             "    }\n"
             "}\n"
-            "\n"
+            "\n",
+            sc
         );
         {
             size_t i, j, k;
             for (i = 0; i < ctx->rules.len; i++) {
                 const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                stream_t *const rs = (parts > 0) ? &rstreams[r->part] : sstream;
                 for (j = 0; j < r->codes.len; j++) {
                     const code_block_t *b;
                     size_t d;
@@ -4585,15 +8105,15 @@ static bool_t generate(context_t *ctx) {
                         break;
                     default:
                         print_error("Internal error [%d]\n", __LINE__);
-                        exit(-1);
+                        exit_e(-1);
                     }
                     stream__printf(
-                        &sstream,
-                        "static void pcc_action_%s_" FMT_LU "(%s_context_t *__pcc_ctx, pcc_thunk_t *__pcc_in, pcc_value_t *__pcc_out) {\n",
-                        r->name, (ulong_t)d, get_prefix(ctx)
+                        rs,
+                        "%svoid pcc_action_%s_" FMT_LU "(%s_context_t *__pcc_ctx, pcc_thunk_t *__pcc_in, pcc_value_t *__pcc_out) {\n",
+                        gc, r->name, (ulong_t)d, get_prefix(ctx)
                     );
                     stream__puts(
-                        &sstream,
+                        rs,
                         "#define auxil (__pcc_ctx->auxil)\n"
                         "#define __ (*__pcc_out)\n"
                     );
@@ -4601,61 +8121,85 @@ static bool_t generate(context_t *ctx) {
                     while (k < v->len) {
                         assert(v->buf[k]->type == NODE_REFERENCE);
                         stream__printf(
-                            &sstream,
-                            "#define %s (*__pcc_in->data.leaf.values.buf[" FMT_LU "])\n",
+                            rs,
+                            "#define %s (__pcc_in->data.leaf.values[" FMT_LU "])\n",
                             v->buf[k]->data.reference.var, (ulong_t)v->buf[k]->data.reference.index
                         );
                         k++;
                     }
                     stream__puts(
-                        &sstream,
+                        rs,
                         "#define _0 pcc_get_capture_string(__pcc_ctx, &__pcc_in->data.leaf.capt0)\n"
                         "#define _0s ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capt0.range.start))\n"
                         "#define _0e ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capt0.range.end))\n"
+                        "#define _0p ((const char *)(__pcc_ctx->buffer.buf + __pcc_in->data.leaf.capt0.range.start))\n"
+                        "#define _0n ((const size_t)(__pcc_in->data.leaf.capt0.range.end - __pcc_in->data.leaf.capt0.range.start))\n"
                     );
                     k = 0;
                     while (k < c->len) {
                         assert(c->buf[k]->type == NODE_CAPTURE);
                         stream__printf(
-                            &sstream,
-                            "#define _" FMT_LU " pcc_get_capture_string(__pcc_ctx, __pcc_in->data.leaf.capts.buf[" FMT_LU "])\n",
+                            rs,
+                            "#define _" FMT_LU " pcc_get_capture_string(__pcc_ctx, &__pcc_in->data.leaf.capts[" FMT_LU "])\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1), (ulong_t)c->buf[k]->data.capture.index
                         );
                         stream__printf(
-                            &sstream,
-                            "#define _" FMT_LU "s ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capts.buf[" FMT_LU "]->range.start))\n",
+                            rs,
+                            "#define _" FMT_LU "s ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capts[" FMT_LU "].range.start))\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1), (ulong_t)c->buf[k]->data.capture.index
                         );
                         stream__printf(
-                            &sstream,
-                            "#define _" FMT_LU "e ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capts.buf[" FMT_LU "]->range.end))\n",
+                            rs,
+                            "#define _" FMT_LU "e ((const size_t)(__pcc_ctx->pos + __pcc_in->data.leaf.capts[" FMT_LU "].range.end))\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1), (ulong_t)c->buf[k]->data.capture.index
                         );
+                        stream__printf(
+                            rs,
+                            "#define _" FMT_LU "p ((const char *)(__pcc_ctx->buffer.buf + __pcc_in->data.leaf.capts[" FMT_LU "].range.start))\n",
+                            (ulong_t)(c->buf[k]->data.capture.index + 1), (ulong_t)c->buf[k]->data.capture.index
+                        );
+                        stream__printf(
+                            rs,
+                            "#define _" FMT_LU "n ((const size_t)(__pcc_in->data.leaf.capts[" FMT_LU "].range.end - __pcc_in->data.leaf.capts[" FMT_LU "].range.start))\n",
+                            (ulong_t)(c->buf[k]->data.capture.index + 1), (ulong_t)c->buf[k]->data.capture.index, (ulong_t)c->buf[k]->data.capture.index
+                        );
                         k++;
                     }
-                    stream__write_code_block(&sstream, b->text, b->len, 4, ctx->iname, b->line);
+                    stream__write_code_block(rs, b->text, b->len, 4, ctx->iname, b->line);
                     k = c->len;
                     while (k > 0) {
                         k--;
                         assert(c->buf[k]->type == NODE_CAPTURE);
                         stream__printf(
-                            &sstream,
+                            rs,
+                            "#undef _" FMT_LU "n\n",
+                            (ulong_t)(c->buf[k]->data.capture.index + 1)
+                        );
+                        stream__printf(
+                            rs,
+                            "#undef _" FMT_LU "p\n",
+                            (ulong_t)(c->buf[k]->data.capture.index + 1)
+                        );
+                        stream__printf(
+                            rs,
                             "#undef _" FMT_LU "e\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1)
                         );
                         stream__printf(
-                            &sstream,
+                            rs,
                             "#undef _" FMT_LU "s\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1)
                         );
                         stream__printf(
-                            &sstream,
+                            rs,
                             "#undef _" FMT_LU "\n",
                             (ulong_t)(c->buf[k]->data.capture.index + 1)
                         );
                     }
                     stream__puts(
-                        &sstream,
+                        rs,
+                        "#undef _0n\n"
+                        "#undef _0p\n"
                         "#undef _0e\n"
                         "#undef _0s\n"
                         "#undef _0\n"
@@ -4665,189 +8209,765 @@ static bool_t generate(context_t *ctx) {
                         k--;
                         assert(v->buf[k]->type == NODE_REFERENCE);
                         stream__printf(
-                            &sstream,
+                            rs,
                             "#undef %s\n",
                             v->buf[k]->data.reference.var
                         );
                     }
                     stream__puts(
-                        &sstream,
+                        rs,
                         "#undef __\n"
                         "#undef auxil\n"
                     );
                     stream__puts(
-                        &sstream,
+                        rs,
                         "}\n"
                         "\n"
                     );
                 }
-            }
-        }
-        {
-            size_t i;
-            for (i = 0; i < ctx->rules.len; i++) {
-                stream__printf(
-                    &sstream,
-                    "static pcc_thunk_chunk_t *pcc_evaluate_rule_%s(pcc_context_t *ctx);\n",
-                    ctx->rules.buf[i]->data.rule.name
+            }
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            size_t i;
+            for (i = 0; i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                stream_t *const rs = (parts > 0) ? &rstreams[r->part] : sstream;
+                stream__printf(
+                    rs,
+                    "%svoid pcc_node_enter_%s(pcc_context_t *ctx, pcc_thunk_t *thunk, pcc_value_t *value) {\n"
+                    "    pcc_ast__enter(\n"
+                    "        ctx, &ctx->ast, " FMT_LU ", ctx->pos + thunk->data.leaf.capt0.range.start, ctx->pos + thunk->data.leaf.capt0.range.end\n"
+                    "    );\n"
+                    "}\n"
+                    "\n"
+                    "%svoid pcc_node_leave_%s(pcc_context_t *ctx, pcc_thunk_t *thunk, pcc_value_t *value) {\n"
+                    "    pcc_ast__leave(ctx, &ctx->ast%s);\n"
+                    "}\n"
+                    "\n",
+                    gc, r->name, (ulong_t)i, gc, r->name,
+                    (ctx->flags & CODE_FLAG__INTERN) ? ", ctx->buffer.buf, ctx->pos" : ""
+                );
+            }
+        }
+        if (ctx->flags & CODE_FLAG__EVENT) {
+            size_t i, j;
+            for (i = 0; i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                stream_t *const rs = (parts > 0) ? &rstreams[r->part] : sstream;
+                stream__printf(
+                    rs,
+                    "%svoid pcc_event_enter_%s(pcc_context_t *ctx, const pcc_event_t *event) {\n"
+                    "    PCC_ON_ENTER(\n"
+                    "        ctx->auxil, \"%s\", ctx->pos + event->range.start,\n"
+                    "        ctx->buffer.buf + event->range.start, event->range.end - event->range.start\n"
+                    "    );\n"
+                    "}\n"
+                    "\n"
+                    "%svoid pcc_event_leave_%s(pcc_context_t *ctx, const pcc_event_t *event) {\n"
+                    "    PCC_ON_LEAVE(\n"
+                    "        ctx->auxil, \"%s\", ctx->pos + event->range.start,\n"
+                    "        ctx->buffer.buf + event->range.start, event->range.end - event->range.start\n"
+                    "    );\n"
+                    "}\n"
+                    "\n",
+                    gc, r->name, r->name, gc, r->name, r->name
+                );
+                for (j = 0; j < r->capts.len; j++) {
+                    stream__printf(
+                        rs,
+                        "%svoid pcc_event_token_%s_" FMT_LU "(pcc_context_t *ctx, const pcc_event_t *event) {\n"
+                        "    PCC_ON_TOKEN(\n"
+                        "        ctx->auxil, \"%s\", " FMT_LU ", ctx->pos + event->range.start,\n"
+                        "        ctx->buffer.buf + event->range.start, event->range.end - event->range.start\n"
+                        "    );\n"
+                        "}\n"
+                        "\n",
+                        gc, r->name, (ulong_t)r->capts.buf[j]->data.capture.index, r->name, (ulong_t)(r->capts.buf[j]->data.capture.index + 1)
+                    );
+                }
+            }
+        }
+        {
+            size_t i;
+            for (i = 0; i < ctx->rules.len; i++) {
+                stream__printf(
+                    us,
+                    "%spcc_thunk_chunk_t *pcc_evaluate_rule_%s(pcc_context_t *ctx);\n",
+                    gc, ctx->rules.buf[i]->data.rule.name
+                );
+            }
+            for (i = 0; i < ctx->rules.len; i++) {
+                if (ctx->rules.buf[i]->data.rule.attrs & RULE_ATTR__SKIP) {
+                    stream__printf(
+                        us,
+                        "%spcc_bool_t pcc_skip_rule_%s(pcc_context_t *ctx);\n",
+                        gc, ctx->rules.buf[i]->data.rule.name
+                    );
+                }
+            }
+            stream__puts(
+                us,
+                "\n"
+            );
+            for (i = 0; i < ctx->rules.len; i++) {
+                const node_t *const rule = ctx->rules.buf[i];
+                code_reach_t r;
+                generate_t g;
+                stream_t *const rs = (parts > 0) ? &rstreams[rule->data.rule.part] : sstream;
+                if (!(rule->data.rule.attrs & RULE_ATTR__SKIP)) continue;
+                g.stream = rs;
+                g.rule = rule;
+                g.label = 0;
+                g.ascii = ctx->opts.ascii;
+                g.chunk = FALSE;
+                g.event = FALSE;
+                stream__printf(
+                    rs,
+                    "%spcc_bool_t pcc_skip_rule_%s(pcc_context_t *ctx) {\n",
+                    gc, rule->data.rule.name
+                );
+                if (is_always_succeeding(rule)) {
+                    bool_t bytes[256];
+                    size_t j, k;
+                    for (j = 0; j < 256; j++) bytes[j] = FALSE;
+                    gather_first_bytes(rule, ctx->opts.ascii, bytes);
+                    for (j = 0; j < 256 && bytes[j]; j++);
+                    if (j < 256) { /* fast path for the bytes that cannot start the pattern */
+                        bool_t b = FALSE;
+                        stream__puts(
+                            rs,
+                            "    {\n"
+                            "        int c;\n"
+                            "        if (pcc_refill_buffer(ctx, 1) < 1) return PCC_TRUE;\n"
+                            "        c = (int)(unsigned char)ctx->buffer.buf[ctx->cur];\n"
+                            "        if (!(\n"
+                        );
+                        for (j = 0; j < 256; j = k) {
+                            char s[5], t[5];
+                            for (; j < 256 && !bytes[j]; j++);
+                            if (j >= 256) break;
+                            for (k = j; k < 256 && bytes[k]; k++);
+                            if (b) stream__puts(rs, " ||\n");
+                            stream__write_characters(rs, ' ', 12);
+                            if (k - j == 1) {
+                                if (j < 0x80)
+                                    stream__printf(rs, "c == '%s'", escape_character((char)j, &s));
+                                else
+                                    stream__printf(rs, "c == 0x%02x", (int)j);
+                            }
+                            else {
+                                if (k - 1 < 0x80)
+                                    stream__printf(rs, "(c >= '%s' && c <= '%s')", escape_character((char)j, &s), escape_character((char)(k - 1), &t));
+                                else if (j < 0x80)
+                                    stream__printf(rs, "(c >= '%s' && c <= 0x%02x)", escape_character((char)j, &s), (int)(k - 1));
+                                else
+                                    stream__printf(rs, "(c >= 0x%02x && c <= 0x%02x)", (int)j, (int)(k - 1));
+                            }
+                            b = TRUE;
+                        }
+                        if (!b) { /* nothing can be consumed */
+                            stream__write_characters(rs, ' ', 12);
+                            stream__puts(rs, "0");
+                        }
+                        stream__puts(
+                            rs,
+                            "\n"
+                            "        )) return PCC_TRUE;\n"
+                            "    }\n"
+                        );
+                    }
+                }
+                r = generate_code(&g, rule->data.rule.expr, 0, 4, FALSE);
+                stream__puts(
+                    rs,
+                    "    return PCC_TRUE;\n"
+                );
+                if (r != CODE_REACH__ALWAYS_SUCCEED) {
+                    stream__puts(
+                        rs,
+                        "L0000:;\n"
+                        "    return PCC_FALSE;\n"
+                    );
+                }
+                stream__puts(
+                    rs,
+                    "}\n"
+                    "\n"
                 );
             }
-            stream__puts(
-                &sstream,
-                "\n"
-            );
             for (i = 0; i < ctx->rules.len; i++) {
                 code_reach_t r;
                 generate_t g;
-                g.stream = &sstream;
+                stream_t *const rs = (parts > 0) ? &rstreams[ctx->rules.buf[i]->data.rule.part] : sstream;
+                g.stream = rs;
                 g.rule = ctx->rules.buf[i];
                 g.label = 0;
                 g.ascii = ctx->opts.ascii;
+                g.chunk = TRUE;
+                g.event = (ctx->flags & CODE_FLAG__EVENT) ? TRUE : FALSE;
+                if (ctx->rules.buf[i]->data.rule.attrs & (RULE_ATTR__SKIP | RULE_ATTR__INLINE)) {
+                    stream__puts(
+                        rs,
+                        "MARK_FUNC_AS_USED\n"
+                    );
+                }
                 stream__printf(
-                    &sstream,
-                    "static pcc_thunk_chunk_t *pcc_evaluate_rule_%s(pcc_context_t *ctx) {\n",
-                    ctx->rules.buf[i]->data.rule.name
+                    rs,
+                    "%spcc_thunk_chunk_t *pcc_evaluate_rule_%s(pcc_context_t *ctx) {\n",
+                    gc, ctx->rules.buf[i]->data.rule.name
                 );
+                if (ctx->rules.buf[i]->data.rule.attrs & RULE_ATTR__THUNKLESS) {
+                    g.chunk = FALSE;
+                    stream__printf(
+                        rs,
+                        "    const size_t pos = ctx->cur; /* the starting position in the character buffer */\n"
+                        "    (void)pos; /* unused if PCC_DEBUG is not defined */\n"
+                        "    PCC_DEBUG(ctx->auxil, PCC_DBG_EVALUATE, \"%s\", ctx->level, pos, (ctx->buffer.buf + pos), (ctx->buffer.len - pos));\n"
+                        "    ctx->level++;\n",
+                        ctx->rules.buf[i]->data.rule.name
+                    );
+                    r = generate_code(&g, ctx->rules.buf[i]->data.rule.expr, 0, 4, FALSE);
+                    stream__printf(
+                        rs,
+                        "    ctx->level--;\n"
+                        "    PCC_DEBUG(ctx->auxil, PCC_DBG_MATCH, \"%s\", ctx->level, pos, (ctx->buffer.buf + pos), (ctx->cur - pos));\n"
+                        "    return &ctx->void_chunk;\n",
+                        ctx->rules.buf[i]->data.rule.name
+                    );
+                    if (r != CODE_REACH__ALWAYS_SUCCEED) {
+                        stream__printf(
+                            rs,
+                            "L0000:;\n"
+                            "    ctx->level--;\n"
+                            "    PCC_DEBUG(ctx->auxil, PCC_DBG_NOMATCH, \"%s\", ctx->level, pos, (ctx->buffer.buf + pos), (ctx->cur - pos));\n"
+                            "    return NULL;\n",
+                            ctx->rules.buf[i]->data.rule.name
+                        );
+                    }
+                    stream__puts(
+                        rs,
+                        "}\n"
+                        "\n"
+                    );
+                    continue;
+                }
                 stream__printf(
-                    &sstream,
-                    "    pcc_thunk_chunk_t *const chunk = pcc_thunk_chunk__create(ctx);\n"
+                    rs,
+                    "    pcc_thunk_chunk_t *const chunk = pcc_thunk_chunk__create(ctx, &ctx->thunk_chunk_recyclers[" FMT_LU "], " FMT_LU ", " FMT_LU ");\n"
                     "    chunk->pos = ctx->cur;\n"
                     "    PCC_DEBUG(ctx->auxil, PCC_DBG_EVALUATE, \"%s\", ctx->level, chunk->pos, (ctx->buffer.buf + chunk->pos), (ctx->buffer.len - chunk->pos));\n"
                     "    ctx->level++;\n",
+                    (ulong_t)ctx->rules.buf[i]->data.rule.layout,
+                    (ulong_t)ctx->rules.buf[i]->data.rule.vars.len,
+                    (ulong_t)ctx->rules.buf[i]->data.rule.capts.len,
                     ctx->rules.buf[i]->data.rule.name
                 );
-                stream__printf(
-                    &sstream,
-                    "    pcc_value_table__resize(ctx->auxil, &chunk->values, " FMT_LU ");\n",
-                    (ulong_t)ctx->rules.buf[i]->data.rule.vars.len
-                );
-                stream__printf(
-                    &sstream,
-                    "    pcc_capture_table__resize(ctx->auxil, &chunk->capts, " FMT_LU ");\n",
-                    (ulong_t)ctx->rules.buf[i]->data.rule.capts.len
-                );
-                if (ctx->rules.buf[i]->data.rule.vars.len > 0) {
-                    stream__puts(
-                        &sstream,
-                        "    pcc_value_table__clear(ctx->auxil, &chunk->values);\n"
+                if (ctx->flags & CODE_FLAG__EVENT) {
+                    stream__printf(
+                        rs,
+                        "    pcc_event_log__open(ctx, &ctx->events, chunk, pcc_event_enter_%s);\n",
+                        ctx->rules.buf[i]->data.rule.name
+                    );
+                }
+                if (ctx->flags & CODE_FLAG__AST) {
+                    stream__printf(
+                        rs,
+                        "    pcc_thunk_array__add_leaf(ctx, &chunk->thunks, pcc_node_enter_%s, NULL, NULL);\n",
+                        ctx->rules.buf[i]->data.rule.name
                     );
                 }
                 r = generate_code(&g, ctx->rules.buf[i]->data.rule.expr, 0, 4, FALSE);
                 stream__printf(
-                    &sstream,
+                    rs,
                     "    ctx->level--;\n"
-                    "    PCC_DEBUG(ctx->auxil, PCC_DBG_MATCH, \"%s\", ctx->level, chunk->pos, (ctx->buffer.buf + chunk->pos), (ctx->cur - chunk->pos));\n"
-                    "    return chunk;\n",
+                    "    PCC_DEBUG(ctx->auxil, PCC_DBG_MATCH, \"%s\", ctx->level, chunk->pos, (ctx->buffer.buf + chunk->pos), (ctx->cur - chunk->pos));\n",
                     ctx->rules.buf[i]->data.rule.name
                 );
+                if (ctx->flags & CODE_FLAG__AST) {
+                    stream__printf(
+                        rs,
+                        "    chunk->thunks.buf[0].data.leaf.capt0.range.start = chunk->pos;\n"
+                        "    chunk->thunks.buf[0].data.leaf.capt0.range.end = ctx->cur;\n"
+                        "    {\n"
+                        "        pcc_thunk_t *const thunk = pcc_thunk_array__add_leaf(ctx, &chunk->thunks, pcc_node_leave_%s, NULL, NULL);\n"
+                        "        thunk->data.leaf.capt0.range = chunk->thunks.buf[0].data.leaf.capt0.range;\n"
+                        "    }\n",
+                        ctx->rules.buf[i]->data.rule.name
+                    );
+                }
+                if (ctx->flags & CODE_FLAG__EVENT) {
+                    stream__printf(
+                        rs,
+                        "    pcc_event_log__close(ctx, &ctx->events, chunk, pcc_event_leave_%s);\n",
+                        ctx->rules.buf[i]->data.rule.name
+                    );
+                }
+                if (ctx->rules.buf[i]->data.rule.attrs & RULE_ATTR__EAGER) {
+                    stream__printf(
+                        rs,
+                        "%s"
+                        "    pcc_do_action(ctx, &chunk->thunks, &chunk->value);\n"
+                        "    chunk->evaluated = PCC_TRUE;\n",
+                        (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__commit(ctx, &ctx->events);\n" : ""
+                    );
+                }
+                stream__puts(
+                    rs,
+                    "    return chunk;\n"
+                );
                 if (r != CODE_REACH__ALWAYS_SUCCEED) {
                     stream__printf(
-                        &sstream,
+                        rs,
                         "L0000:;\n"
                         "    ctx->level--;\n"
                         "    PCC_DEBUG(ctx->auxil, PCC_DBG_NOMATCH, \"%s\", ctx->level, chunk->pos, (ctx->buffer.buf + chunk->pos), (ctx->cur - chunk->pos));\n"
+                        "%s"
                         "    pcc_thunk_chunk__destroy(ctx, chunk);\n"
                         "    return NULL;\n",
-                        ctx->rules.buf[i]->data.rule.name
+                        ctx->rules.buf[i]->data.rule.name,
+                        (ctx->flags & CODE_FLAG__EVENT) ? "    pcc_event_log__revert(ctx, &ctx->events, chunk->events.start);\n" : ""
                     );
                 }
                 stream__puts(
-                    &sstream,
+                    rs,
                     "}\n"
                     "\n"
                 );
             }
         }
+        if (rt != NULL) {
+            size_t i, k = 0;
+            stream__puts(
+                sstream,
+                "static int pcc_hook_get_char(pcc_auxil_t auxil) {\n"
+                "    return PCC_GETCHAR(auxil);\n"
+                "}\n"
+                "\n"
+                "static int pcc_hook_canceled(pcc_auxil_t auxil) {\n"
+                "    return PCC_CANCELED(auxil);\n"
+                "}\n"
+                "\n"
+                "static void pcc_hook_value_init(pcc_auxil_t auxil, pcc_value_t *value) {\n"
+                "    PCC_VALUE_INIT(auxil, value);\n"
+                "}\n"
+                "\n"
+                "static void pcc_hook_value_move(pcc_auxil_t auxil, pcc_value_t *dst, pcc_value_t *src) {\n"
+                "    PCC_VALUE_MOVE(auxil, dst, src);\n"
+                "}\n"
+                "\n"
+                "static void pcc_hook_value_destroy(pcc_auxil_t auxil, pcc_value_t *value) {\n"
+                "    PCC_VALUE_DESTROY(auxil, value);\n"
+                "}\n"
+                "\n"
+                "static const size_t pcc_layouts[] = { /* the numbers of the values and the captures of the thunk chunk layouts */\n"
+            );
+            for (i = 0; i < ctx->rules.len; i++) {
+                const node_rule_t *const r = &ctx->rules.buf[i]->data.rule;
+                if (r->layout != k) continue; /* not the first rule with the layout */
+                stream__printf(
+                    sstream,
+                    "    " FMT_LU ", " FMT_LU "%s\n",
+                    (ulong_t)r->vars.len, (ulong_t)r->capts.len, (k + 1 < layouts) ? "," : ""
+                );
+                k++;
+            }
+            if (layouts == 0) {
+                stream__puts(
+                    sstream,
+                    "    0, 0\n"
+                );
+            }
+            stream__printf(
+                sstream,
+                "};\n"
+                "\n"
+                "static const pcc_hooks_t pcc_hooks = {\n"
+                "    pcc_hook_get_char,\n"
+                "    pcc_hook_canceled,\n"
+                "    pcc_hook_value_init,\n"
+                "    pcc_hook_value_move,\n"
+                "    pcc_hook_value_destroy,\n"
+                "    pcc_layouts,\n"
+                "    " FMT_LU "\n"
+                "};\n"
+                "\n",
+                (ulong_t)((layouts > 0) ? layouts : 1)
+            );
+        }
         stream__printf(
-            &sstream,
+            sstream,
             "%s_context_t *%s_create(%s%sauxil) {\n",
             get_prefix(ctx), get_prefix(ctx),
             at, ap ? "" : " "
         );
-        stream__puts(
-            &sstream,
-            "    return pcc_context__create(auxil);\n"
+        stream__printf(
+            sstream,
+            "    return pcc_context__create(auxil%s);\n"
             "}\n"
-            "\n"
+            "\n",
+            (rt != NULL) ? ", &pcc_hooks" : ""
         );
         stream__printf(
-            &sstream,
+            sstream,
             "int %s_parse(%s_context_t *ctx, %s%s*ret) {\n",
             get_prefix(ctx), get_prefix(ctx),
             vt, vp ? "" : " "
         );
+        stream__puts(
+            sstream,
+            "    if (ctx->status != 0) return ctx->status;\n"
+        );
+        if (ctx->flags & CODE_FLAG__AST) {
+            stream__puts(
+                sstream,
+                "    pcc_ast__clear(ctx->auxil, &ctx->ast);\n"
+            );
+        }
         if (ctx->rules.len > 0) {
             stream__printf(
-                &sstream,
-                "    if (pcc_apply_rule(ctx, pcc_evaluate_rule_%s, &ctx->thunks, ret))\n",
-                ctx->rules.buf[0]->data.rule.name
+                sstream,
+                "    if (pcc_apply_rule(ctx, pcc_evaluate_rule_%s, &ctx->thunks, ret) && ctx->status == 0)%s\n",
+                ctx->rules.buf[0]->data.rule.name,
+                (ctx->flags & CODE_FLAG__EVENT) ? " {" : ""
             );
+            {
+                char *const q = strdup_e(get_prefix(ctx));
+                make_header_identifier(q);
+                stream__printf(
+                    sstream,
+                    "%s"
+                    "        pcc_do_action(ctx, &ctx->thunks, ret);\n"
+                    "%s"
+                    "    else if (ctx->status == 0) {\n"
+                    "        PCC_ERROR(ctx->auxil);\n"
+                    "#ifdef PCC_USE_ERROR_STATUS\n"
+                    "        ctx->status = %s_STATUS_SYNTAX_ERROR;\n"
+                    "#endif /* PCC_USE_ERROR_STATUS */\n"
+                    "    }\n"
+                    "    pcc_commit_buffer(ctx);\n",
+                    (ctx->flags & CODE_FLAG__EVENT) ? "        pcc_event_log__commit(ctx, &ctx->events);\n" : "",
+                    (ctx->flags & CODE_FLAG__EVENT) ? "    }\n" : "",
+                    q
+                );
+                free(q);
+            }
+        }
+        stream__puts(
+            sstream,
+            "    pcc_thunk_array__revert(ctx, &ctx->thunks, 0);\n"
+        );
+        if (ctx->flags & CODE_FLAG__ARENA) {
             stream__puts(
-                &sstream,
-                "        pcc_do_action(ctx, &ctx->thunks, ret);\n"
-                "    else\n"
-                "        PCC_ERROR(ctx->auxil);\n"
-                "    pcc_commit_buffer(ctx);\n"
+                sstream,
+                "    pcc_context__release(ctx);\n"
             );
         }
         stream__puts(
-            &sstream,
-            "    pcc_thunk_array__revert(ctx->auxil, &ctx->thunks, 0);\n"
+            sstream,
+            "    if (ctx->status != 0) return ctx->status;\n"
             "    return pcc_refill_buffer(ctx, 1) >= 1;\n"
             "}\n"
             "\n"
         );
         stream__printf(
-            &sstream,
+            sstream,
             "void %s_destroy(%s_context_t *ctx) {\n",
             get_prefix(ctx), get_prefix(ctx)
         );
         stream__puts(
-            &sstream,
+            sstream,
             "    pcc_context__destroy(ctx);\n"
             "}\n"
         );
+        stream__printf(
+            sstream,
+            "\n"
+            "void %s_reset(%s_context_t *ctx, %s%sauxil) {\n"
+            "    pcc_context__reset(ctx, auxil);\n"
+            "}\n"
+            "\n"
+            "void %s_trim(%s_context_t *ctx) {\n"
+            "    pcc_context__trim(ctx);\n"
+            "}\n"
+            "\n"
+            "void %s_set_memory_limit(%s_context_t *ctx, size_t limit) {\n"
+            "    ctx->budget.limit = limit;\n"
+            "    ctx->budget.margin = (limit > 0) ? limit - (limit >> 2) : PCC_VOID_VALUE; /* starts saving memory at 3/4 of the limit */\n"
+            "}\n"
+            "\n"
+            "void %s_set_step_limit(%s_context_t *ctx, size_t limit) {\n"
+            "    ctx->step_limit = (limit > 0) ? limit : PCC_VOID_VALUE;\n"
+            "}\n"
+            "\n"
+            "void %s_set_depth_limit(%s_context_t *ctx, size_t limit) {\n"
+            "    ctx->depth_limit = (limit > 0) ? limit : PCC_VOID_VALUE;\n"
+            "}\n",
+            get_prefix(ctx), get_prefix(ctx),
+            at, ap ? "" : " ",
+            get_prefix(ctx), get_prefix(ctx),
+            get_prefix(ctx), get_prefix(ctx),
+            get_prefix(ctx), get_prefix(ctx),
+            get_prefix(ctx), get_prefix(ctx)
+        );
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__printf(
+                sstream,
+                "\n"
+                "void %s_set_arena(%s_context_t *ctx, void *region, size_t size) {\n"
+                "    pcc_arena__set_region(ctx->auxil, &ctx->arena, region, size);\n"
+                "}\n",
+                get_prefix(ctx), get_prefix(ctx)
+            );
+        }
+        if (ctx->flags & CODE_FLAG__INTERN) {
+            stream__printf(
+                sstream,
+                "\n"
+                "void %s_clear_strings(%s_context_t *ctx) {\n"
+                "    pcc_string_table__clear(ctx, &ctx->strings);\n"
+                "}\n",
+                get_prefix(ctx), get_prefix(ctx)
+            );
+        }
+        if (ctx->flags & CODE_FLAG__STATS) {
+            stream__printf(
+                sstream,
+                "\n"
+                "void %s_get_stats(const %s_context_t *ctx, %s_stats_t *stats) {\n"
+                "    size_t i;\n"
+                "    *stats = ctx->stats;\n"
+                "    stats->lrtable_length = ctx->lrtable.len - ctx->lrtable.ofs;\n"
+                "    stats->lrtable_offset = ctx->lrtable.ofs;\n"
+                "    stats->pool_bytes = 0;\n"
+                "    for (i = 0; i < %s; i++) {\n"
+                "        stats->pool_bytes += pcc_memory_recycler__size(ctx, &ctx->thunk_chunk_recyclers[i]);\n"
+                "    }\n"
+                "    stats->pool_bytes += pcc_memory_recycler__size(ctx, &ctx->lr_head_recycler);\n"
+                "    stats->pool_bytes += pcc_memory_recycler__size(ctx, &ctx->lr_answer_recycler);\n"
+                "    stats->buffer_capacity = ctx->buffer.max;\n"
+                "    stats->memory_bytes = ctx->budget.used;\n"
+                "    if (stats->memory_peak_bytes < stats->memory_bytes) stats->memory_peak_bytes = stats->memory_bytes;\n"
+                "}\n",
+                get_prefix(ctx), get_prefix(ctx), get_prefix(ctx), nl
+            );
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            const char *const p = get_prefix(ctx);
+            size_t i;
+            stream__printf(
+                sstream,
+                "\n"
+                "size_t %s_ast_count(const %s_context_t *ctx) {\n"
+                "    return ctx->ast.len;\n"
+                "}\n"
+                "\n"
+                "%s_ast_rule_t %s_ast_rule(const %s_context_t *ctx, size_t node) {\n"
+                "    return (%s_ast_rule_t)ctx->ast.rules[node];\n"
+                "}\n"
+                "\n"
+                "const char *%s_ast_rule_name(%s_ast_rule_t rule) {\n"
+                "    static const char *const names[] = {\n",
+                p, p, p, p, p, p, p, p
+            );
+            for (i = 0; i < ctx->rules.len; i++) {
+                stream__printf(
+                    sstream,
+                    "        \"%s\"%s\n",
+                    ctx->rules.buf[i]->data.rule.name, (i + 1 < ctx->rules.len) ? "," : ""
+                );
+            }
+            stream__printf(
+                sstream,
+                "    };\n"
+                "    return names[rule];\n"
+                "}\n"
+                "\n"
+                "size_t %s_ast_start(const %s_context_t *ctx, size_t node) {\n"
+                "    return ctx->ast.ranges[node].start;\n"
+                "}\n"
+                "\n"
+                "size_t %s_ast_end(const %s_context_t *ctx, size_t node) {\n"
+                "    return ctx->ast.ranges[node].end;\n"
+                "}\n"
+                "\n"
+                "size_t %s_ast_child_count(const %s_context_t *ctx, size_t node) {\n"
+                "    return ctx->ast.counts[node];\n"
+                "}\n"
+                "\n"
+                "size_t %s_ast_child(const %s_context_t *ctx, size_t node, size_t index) {\n"
+                "    return ctx->ast.children.buf[ctx->ast.firsts[node] + index];\n"
+                "}\n",
+                p, p, p, p, p, p, p, p
+            );
+        }
     }
     {
         stream__puts(
-            &hstream,
+            hstream,
             "#ifdef __cplusplus\n"
             "extern \"C\" {\n"
             "#endif\n"
             "\n"
         );
         stream__printf(
-            &hstream,
+            hstream,
             "typedef struct %s_context_tag %s_context_t;\n"
             "\n",
-            get_prefix(ctx), get_prefix(ctx)
+            rp, get_prefix(ctx)
         );
+        {
+            char *const q = strdup_e(get_prefix(ctx));
+            make_header_identifier(q);
+            stream__printf(
+                hstream,
+                "typedef enum %s_status_tag {\n"
+                "    %s_STATUS_MEMORY_LIMIT = -1, /* the memory limit has been exceeded */\n"
+                "    %s_STATUS_STEP_LIMIT = -2, /* the step limit has been exceeded */\n"
+                "    %s_STATUS_CANCELED = -3, /* PCC_CANCELED() has returned nonzero */\n"
+                "    %s_STATUS_DEPTH_LIMIT = -4, /* the depth limit has been exceeded */\n"
+                "    %s_STATUS_SYNTAX_ERROR = -5 /* a syntax error has occurred with PCC_USE_ERROR_STATUS defined */\n"
+                "} %s_status_t;\n"
+                "\n",
+                get_prefix(ctx), q, q, q, q, q, get_prefix(ctx)
+            );
+            free(q);
+        }
         stream__printf(
-            &hstream,
+            hstream,
             "%s_context_t *%s_create(%s%sauxil);\n",
             get_prefix(ctx), get_prefix(ctx),
             at, ap ? "" : " "
         );
         stream__printf(
-            &hstream,
+            hstream,
             "int %s_parse(%s_context_t *ctx, %s%s*ret);\n",
             get_prefix(ctx), get_prefix(ctx),
             vt, vp ? "" : " "
         );
         stream__printf(
-            &hstream,
+            hstream,
             "void %s_destroy(%s_context_t *ctx);\n",
             get_prefix(ctx), get_prefix(ctx)
         );
+        stream__printf(
+            hstream,
+            "void %s_reset(%s_context_t *ctx, %s%sauxil);\n",
+            get_prefix(ctx), get_prefix(ctx),
+            at, ap ? "" : " "
+        );
+        stream__printf(
+            hstream,
+            "void %s_trim(%s_context_t *ctx);\n",
+            get_prefix(ctx), get_prefix(ctx)
+        );
+        stream__printf(
+            hstream,
+            "void %s_set_memory_limit(%s_context_t *ctx, size_t limit);\n",
+            get_prefix(ctx), get_prefix(ctx)
+        );
+        stream__printf(
+            hstream,
+            "void %s_set_step_limit(%s_context_t *ctx, size_t limit);\n",
+            get_prefix(ctx), get_prefix(ctx)
+        );
+        stream__printf(
+            hstream,
+            "void %s_set_depth_limit(%s_context_t *ctx, size_t limit);\n",
+            get_prefix(ctx), get_prefix(ctx)
+        );
+        if (ctx->flags & CODE_FLAG__ARENA) {
+            stream__printf(
+                hstream,
+                "void %s_set_arena(%s_context_t *ctx, void *region, size_t size);\n",
+                get_prefix(ctx), get_prefix(ctx)
+            );
+        }
+        if (ctx->flags & CODE_FLAG__INTERN) {
+            stream__printf(
+                hstream,
+                "void %s_clear_strings(%s_context_t *ctx);\n",
+                get_prefix(ctx), get_prefix(ctx)
+            );
+        }
+        if (ctx->flags & CODE_FLAG__STATS) {
+            const char *const p = get_prefix(ctx);
+            if (rt != NULL) {
+                char *const q = strdup_e(rp);
+                make_header_identifier(q);
+                stream__printf(
+                    hstream,
+                    "\n"
+                    "#ifndef PCC_DEFINED_%s_STATS\n"
+                    "#define PCC_DEFINED_%s_STATS\n"
+                    "struct %s_stats_tag {\n"
+                    "%s"
+                    "};\n"
+                    "#endif /* !PCC_DEFINED_%s_STATS */\n"
+                    "\n"
+                    "typedef struct %s_stats_tag %s_stats_t;\n",
+                    q, q, rp, sm, q, rp, p
+                );
+                free(q);
+            }
+            else {
+                stream__printf(
+                    hstream,
+                    "\n"
+                    "typedef struct %s_stats_tag {\n"
+                    "%s"
+                    "} %s_stats_t;\n",
+                    p, sm, p
+                );
+            }
+            stream__printf(
+                hstream,
+                "\n"
+                "void %s_get_stats(const %s_context_t *ctx, %s_stats_t *stats);\n",
+                p, p, p
+            );
+        }
+        if (ctx->flags & CODE_FLAG__AST) {
+            const char *const p = get_prefix(ctx);
+            char *const q = strdup_e(p);
+            size_t i;
+            make_header_identifier(q);
+            stream__printf(
+                hstream,
+                "\n"
+                "typedef enum %s_ast_rule_tag {\n",
+                p
+            );
+            for (i = 0; i < ctx->rules.len; i++) {
+                stream__printf(
+                    hstream,
+                    "    %s_AST_RULE_%s%s\n",
+                    q, ctx->rules.buf[i]->data.rule.name, (i + 1 < ctx->rules.len) ? "," : ""
+                );
+            }
+            stream__printf(
+                hstream,
+                "} %s_ast_rule_t;\n"
+                "\n"
+                "size_t %s_ast_count(const %s_context_t *ctx);\n"
+                "%s_ast_rule_t %s_ast_rule(const %s_context_t *ctx, size_t node);\n"
+                "const char *%s_ast_rule_name(%s_ast_rule_t rule);\n"
+                "size_t %s_ast_start(const %s_context_t *ctx, size_t node);\n"
+                "size_t %s_ast_end(const %s_context_t *ctx, size_t node);\n"
+                "size_t %s_ast_child_count(const %s_context_t *ctx, size_t node);\n"
+                "size_t %s_ast_child(const %s_context_t *ctx, size_t node, size_t index);\n",
+                p, p, p, p, p, p, p, p, p, p, p, p, p, p, p, p
+            );
+            free(q);
+        }
         stream__puts(
-            &hstream,
+            hstream,
             "\n"
             "#ifdef __cplusplus\n"
             "}\n"
             "#endif\n"
         );
         stream__printf(
-            &hstream,
+            hstream,
             "\n"
             "#endif /* !PCC_INCLUDED_%s */\n",
             ctx->hid
@@ -4855,27 +8975,108 @@ static bool_t generate(context_t *ctx) {
     }
     {
         match_eol(ctx);
-        if (!match_eof(ctx)) stream__putc(&sstream, '\n');
+        if (!match_eof(ctx)) stream__putc(sstream, '\n');
         commit_buffer(ctx);
         if (ctx->opts.lines && !match_eof(ctx))
-            stream__write_line_directive(&sstream, ctx->iname, ctx->linenum);
+            stream__write_line_directive(sstream, ctx->iname, ctx->linenum);
         while (refill_buffer(ctx, ctx->buffer.max) > 0) {
             const size_t n = ctx->buffer.len;
-            stream__write_text(&sstream, ctx->buffer.buf, (n > 0 && ctx->buffer.buf[n - 1] == '\r') ? n - 1 : n);
+            stream__write_text(sstream, ctx->buffer.buf, (n > 0 && ctx->buffer.buf[n - 1] == '\r') ? n - 1 : n);
             ctx->bufcur = n;
             commit_buffer(ctx);
         }
     }
-    fclose_e(hstream.file);
-    fclose_e(sstream.file);
-    if (ctx->errnum) {
-        unlink(ctx->hname);
-        unlink(ctx->sname);
-        return FALSE;
+    if (parts > 0) {
+        stream__printf(
+            pstream,
+            "\n"
+            "#endif /* !PCC_INCLUDED_%s */\n",
+            pid
+        );
     }
-    return TRUE;
+    if (rt != NULL) {
+        char *const q = strdup_e(ustream->name);
+        make_header_identifier(q);
+        stream__printf(
+            ustream,
+            "\n"
+            "#endif /* !PCC_INCLUDED_%s */\n",
+            q
+        );
+        free(q);
+    }
+    {
+        size_t i;
+        if (ctx->errnum == 0) {
+            save_stream(hstream);
+            save_stream(sstream);
+            if (parts > 0) save_stream(pstream);
+            for (i = 0; i < parts; i++) save_stream(&rstreams[i]);
+            if (rt != NULL) {
+                save_stream(tstream);
+                save_stream(ustream);
+            }
+            remove_stale_parts(ctx, parts);
+        }
+        else if (!has_output_sink()) {
+            unlink(ctx->hname);
+            unlink(ctx->sname);
+            if (parts > 0) unlink(pname);
+            for (i = 0; i < parts; i++) unlink(rstreams[i].name);
+        }
+        release_outputs(&ctx->outputs);
+    }
+    return (ctx->errnum == 0) ? TRUE : FALSE;
+}
+
+#ifdef PCC_LIBRARY
+
+void packcc_options_init(packcc_options_t *opts) {
+    opts->ascii = 0;
+    opts->lines = 0;
+    opts->debug = 0;
+    opts->level = 1;
+    opts->split = 0;
+    opts->runtime = NULL;
+}
+
+int packcc_generate(const char *name, const char *text, size_t length, const char *oname, const packcc_options_t *opts, const packcc_sink_t *sink) {
+    context_t *volatile ctx = NULL;
+    jmp_buf e;
+    options_t o;
+    int r;
+    {
+        packcc_options_t d;
+        if (opts == NULL) {
+            packcc_options_init(&d);
+            opts = &d;
+        }
+        if (opts->level < 0 || opts->level > 3 || opts->split > SPLIT_MAX) return 1;
+        if (opts->runtime != NULL && !is_identifier_string(extract_filename(opts->runtime))) return 1;
+        o.ascii = opts->ascii ? TRUE : FALSE;
+        o.lines = opts->lines ? TRUE : FALSE;
+        o.debug = opts->debug ? TRUE : FALSE;
+        o.level = opts->level;
+        o.split = opts->split;
+        o.runtime = opts->runtime;
+    }
+    g_sink = sink;
+    g_iname = (name && name[0]) ? name : "-";
+    g_exit = &e;
+    r = setjmp(e);
+    if (r == 0) {
+        ctx = create_context(g_iname, (text != NULL) ? text : "", length, oname, &o);
+        r = (parse(ctx) && optimize(ctx) && generate(ctx)) ? 0 : 10;
+    }
+    g_exit = NULL; /* exits the process if the destruction fails */
+    destroy_context(ctx);
+    g_iname = NULL;
+    g_sink = NULL;
+    return r;
 }
 
+#else /* !PCC_LIBRARY */
+
 static void print_version(FILE *output) {
     fprintf(output, "%s version %s\n", g_cmdname, VERSION);
     fprintf(output, "Copyright (c) 2014, 2019-2022 Arihiro Yoshida. All rights reserved.\n");
@@ -4889,6 +9090,9 @@ static void print_usage(FILE *output) {
     fprintf(output, "  -a, --ascii    disable UTF-8 support\n");
     fprintf(output, "  -l, --lines    add #line directives\n");
     fprintf(output, "  -d, --debug    with debug information\n");
+    fprintf(output, "  -O LEVEL       specify an optimization level from 0 to 3 (default: 1)\n");
+    fprintf(output, "  --split=N      distribute the rule functions among N source files\n");
+    fprintf(output, "  --runtime=NAME refer to the runtime in NAME.c and NAME.h shared with other parsers\n");
     fprintf(output, "  -h, --help     print this help message and exit\n");
     fprintf(output, "  -v, --version  print the version and exit\n");
 }
@@ -4900,6 +9104,9 @@ int main(int argc, char **argv) {
     opts.ascii = FALSE;
     opts.lines = FALSE;
     opts.debug = FALSE;
+    opts.level = 1;
+    opts.split = 0;
+    opts.runtime = NULL;
 #ifdef _MSC_VER
 #ifdef _DEBUG
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -4914,6 +9121,9 @@ int main(int argc, char **argv) {
         bool_t opt_a = FALSE;
         bool_t opt_l = FALSE;
         bool_t opt_d = FALSE;
+        int opt_O = 1;
+        size_t opt_split = 0;
+        const char *opt_runtime = NULL;
         bool_t opt_h = FALSE;
         bool_t opt_v = FALSE;
         int i;
@@ -4940,6 +9150,44 @@ int main(int argc, char **argv) {
                 }
                 opt_o = o;
             }
+            else if (argv[i][1] == 'O') {
+                const char *const o = (argv[i][2] != '\0') ? argv[i] + 2 : (++i < argc) ?  argv[i] : NULL;
+                if (o == NULL) {
+                    print_error("Optimization level missing\n");
+                    fprintf(stderr, "\n");
+                    print_usage(stderr);
+                    exit(1);
+                }
+                if (o[0] < '0' || o[0] > '3' || o[1] != '\0') {
+                    print_error("Invalid optimization level '%s'\n", o);
+                    fprintf(stderr, "\n");
+                    print_usage(stderr);
+                    exit(1);
+                }
+                opt_O = o[0] - '0';
+            }
+            else if (strncmp(argv[i], "--split=", 8) == 0) {
+                const char *const o = argv[i] + 8;
+                size_t n = 0, k;
+                for (k = 0; o[k] >= '0' && o[k] <= '9' && n <= SPLIT_MAX; k++) n = n * 10 + (size_t)(o[k] - '0');
+                if (k == 0 || o[k] != '\0' || n < 1 || n > SPLIT_MAX) {
+                    print_error("Invalid number of source files '%s'\n", o);
+                    fprintf(stderr, "\n");
+                    print_usage(stderr);
+                    exit(1);
+                }
+                opt_split = n;
+            }
+            else if (strncmp(argv[i], "--runtime=", 10) == 0) {
+                const char *const o = argv[i] + 10;
+                if (!is_identifier_string(extract_filename(o))) {
+                    print_error("Invalid runtime name '%s'\n", o);
+                    fprintf(stderr, "\n");
+                    print_usage(stderr);
+                    exit(1);
+                }
+                opt_runtime = o;
+            }
             else if (strcmp(argv[i], "-a") == 0 || strcmp(argv[i], "--ascii") == 0) {
                 opt_a = TRUE;
             }
@@ -4985,12 +9233,17 @@ int main(int argc, char **argv) {
         opts.ascii = opt_a;
         opts.lines = opt_l;
         opts.debug = opt_d;
+        opts.level = opt_O;
+        opts.split = opt_split;
+        opts.runtime = opt_runtime;
     }
     {
-        context_t *const ctx = create_context(iname, oname, &opts);
-        const int b = parse(ctx) && generate(ctx);
+        context_t *const ctx = create_context(iname, NULL, 0, oname, &opts);
+        const int b = parse(ctx) && optimize(ctx) && generate(ctx);
         destroy_context(ctx);
         if (!b) exit(10);
     }
     return 0;
 }
+
+#endif /* !PCC_LIBRARY */
@@ -0,0 +1,70 @@
+/*
+ * PackCC: a packrat parser generator for C.
+ *
+ * Copyright (c) 2014, 2019-2022 Arihiro Yoshida. All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PACKCC_INCLUDED_PACKCC_H
+#define PACKCC_INCLUDED_PACKCC_H
+
+/*
+ * The API available if packcc.c is compiled with PCC_LIBRARY defined.
+ * The functions must not be called concurrently from multiple threads.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct packcc_options_tag {
+    int ascii;    /* UTF-8 support is disabled if nonzero */
+    int lines;    /* #line directives are output if nonzero */
+    int debug;    /* debug information is output to the standard output if nonzero */
+    int level;    /* the optimization level from 0 to 3 */
+    size_t split; /* the number of the source files for the rules (0 means not split) */
+    const char *runtime; /* the base name of the shared runtime files (NULL means the runtime is embedded) */
+} packcc_options_t;
+
+typedef struct packcc_diagnostic_tag {
+    const char *name;    /* the name of the PEG text (NULL if the error is not located in it) */
+    size_t line;         /* the line number (1-based; 0 if not located) */
+    size_t col;          /* the column number (1-based; 0 if not located) */
+    const char *message; /* the error message without the location */
+} packcc_diagnostic_t;
+
+typedef struct packcc_sink_tag {
+    /* receives each generated file instead of writing it (NULL means writing it) */
+    void (*output)(void *data, const char *name, const char *text, size_t length);
+    /* receives each error instead of printing it to the standard error (NULL means printing it) */
+    void (*report)(void *data, const packcc_diagnostic_t *diag);
+    void *data; /* the user-defined data passed to the above functions */
+} packcc_sink_t;
+
+void packcc_options_init(packcc_options_t *opts);
+int packcc_generate(const char *name, const char *text, size_t length, const char *oname, const packcc_options_t *opts, const packcc_sink_t *sink);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !PACKCC_INCLUDED_PACKCC_H */
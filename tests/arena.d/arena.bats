@@ -0,0 +1,21 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing arena.d - generation" {
+    PACKCC_OPTS=(-O2)
+    test_generate
+}
+
+@test "Testing arena.d - check code" {
+    in_header "void pcc_set_arena(pcc_context_t *ctx, void *region, size_t size);"
+    in_source "pcc_context__release(ctx);"
+}
+
+@test "Testing arena.d - compilation" {
+    test_compile
+}
+
+@test "Testing arena.d - run" {
+    run_for_input "arena.d/input.txt"
+}
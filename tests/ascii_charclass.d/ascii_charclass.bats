@@ -0,0 +1,27 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing ascii_charclass.d - generation [positive]" {
+    test_generate "positive.peg"
+}
+
+@test "Testing ascii_charclass.d - check code [positive]" {
+    ! in_source "pcc_get_char_as_utf32"
+}
+
+@test "Testing ascii_charclass.d - generation" {
+    test_generate
+}
+
+@test "Testing ascii_charclass.d - check code" {
+    in_source "pcc_get_char_as_utf32"
+}
+
+@test "Testing ascii_charclass.d - compilation" {
+    test_compile
+}
+
+@test "Testing ascii_charclass.d - run" {
+    run_for_input "ascii_charclass.d/input.txt"
+}
@@ -0,0 +1,27 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing ast.d - generation" {
+    test_generate
+}
+
+@test "Testing ast.d - check code" {
+    in_header "PCC_AST_RULE_SUM,"
+    in_header "size_t pcc_ast_child(const pcc_context_t *ctx, size_t node, size_t index);"
+    in_source "pcc_ast__leave(ctx, &ctx->ast);"
+}
+
+@test "Testing ast.d - compilation" {
+    test_compile
+}
+
+@test "Testing ast.d - run" {
+    run_for_input "ast.d/input.txt"
+}
+
+@test "Testing ast.d - eager rule" {
+    run test_generate "eager.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Rule 'LINE' for %eager not allowed with %ast"* ]]
+}
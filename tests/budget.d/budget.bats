@@ -0,0 +1,22 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing budget.d - generation" {
+    PACKCC_OPTS=(-O0)
+    test_generate
+}
+
+@test "Testing budget.d - check code" {
+    in_header "void pcc_set_memory_limit(pcc_context_t *ctx, size_t limit);"
+    in_header "PCC_STATUS_MEMORY_LIMIT = -1"
+    in_header "#include <stddef.h>"
+}
+
+@test "Testing budget.d - compilation" {
+    test_compile
+}
+
+@test "Testing budget.d - run" {
+    run_for_input "budget.d/input.txt"
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing depth.d - generation" {
+    test_generate
+}
+
+@test "Testing depth.d - check code" {
+    in_header "void pcc_set_depth_limit(pcc_context_t *ctx, size_t limit);"
+    in_header "PCC_STATUS_DEPTH_LIMIT = -4"
+}
+
+@test "Testing depth.d - compilation" {
+    test_compile
+}
+
+@test "Testing depth.d - run" {
+    run_for_input "depth.d/input.txt"
+}
@@ -0,0 +1,43 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing eager.d - generation" {
+    test_generate
+}
+
+@test "Testing eager.d - check code" {
+    in_source "pcc_do_action(ctx, &chunk->thunks, &chunk->value);"
+}
+
+@test "Testing eager.d - compilation" {
+    test_compile
+}
+
+@test "Testing eager.d - run" {
+    run_for_input "eager.d/input.txt"
+}
+
+@test "Testing eager.d - left-recursive rule" {
+    run test_generate "left_recursion.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Left-recursive rule 'EXPR' not allowed for %eager"* ]]
+}
+
+@test "Testing eager.d - rule in predicate" {
+    run test_generate "predicate.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Rule 'WORD' for %eager referred to in predicate in rule 'LINE'"* ]]
+}
+
+@test "Testing eager.d - rule in non-final alternative" {
+    run test_generate "alternative.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Rule 'NUM' for %eager possibly backtracked over in rule 'STMT'"* ]]
+}
+
+@test "Testing eager.d - rule in quantifier" {
+    run test_generate "quantifier.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Rule 'WORD' for %eager possibly backtracked over in rule 'LIST'"* ]]
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing event.d - generation" {
+    test_generate
+}
+
+@test "Testing event.d - check code" {
+    in_source "pcc_event_log__open(ctx, &ctx->events, chunk, pcc_event_enter_SUM);"
+    in_source "pcc_event_log__add(ctx, &ctx->events, pcc_event_token_NUM_0, p, q);"
+    ! in_source "pcc_thunk_array__add_leaf(ctx, &chunk->thunks,"
+}
+
+@test "Testing event.d - compilation" {
+    test_compile
+}
+
+@test "Testing event.d - run" {
+    run_for_input "event.d/input.txt"
+}
+
+@test "Testing event.d - run [O2]" {
+    PACKCC_OPTS=(-O2)
+    test_generate
+    test_compile
+    run_for_input "event.d/input.txt"
+}
+
+@test "Testing event.d - run [O3]" {
+    PACKCC_OPTS=(-O3)
+    test_generate
+    test_compile
+    run_for_input "event.d/input.txt"
+}
+
+@test "Testing event.d - backtracking" {
+    test_generate "backtrack.peg"
+    test_compile
+    run_for_input "event.d/input_backtrack.txt"
+}
+
+@test "Testing event.d - backtracking with AddressSanitizer" {
+    test_generate "backtrack.peg"
+    if ! test_compile -fsanitize=address,undefined -fno-omit-frame-pointer &> /dev/null; then
+        skip "AddressSanitizer is not available"
+    fi
+    run_for_input "event.d/input_backtrack.txt"
+}
+
+@test "Testing event.d - streaming with eager rule" {
+    test_generate "stream.peg"
+    test_compile
+    run_for_input "event.d/input_stream.txt"
+}
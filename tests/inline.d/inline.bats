@@ -0,0 +1,62 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing inline.d - generation" {
+    PACKCC_OPTS=(-O2)
+    test_generate
+}
+
+@test "Testing inline.d - check code" {
+    in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_ITEM,"
+}
+
+@test "Testing inline.d - check code [NUMBER]" {
+    ! in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_NUMBER,"
+}
+
+@test "Testing inline.d - check code [DIGIT]" {
+    ! in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_DIGIT,"
+}
+
+@test "Testing inline.d - check code [SEP]" {
+    ! in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_SEP,"
+}
+
+@test "Testing inline.d - compilation" {
+    test_compile
+}
+
+@test "Testing inline.d - run" {
+    run_for_input "inline.d/input.txt"
+}
+
+@test "Testing inline.d - recursive rule" {
+    run test_generate "recursive.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Recursive rule 'LIST' not allowed for %inline"* ]]
+}
+
+@test "Testing inline.d - rule with action" {
+    run test_generate "action.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"not allowed in rule 'WORD' for %inline"* ]]
+}
+
+@test "Testing inline.d - rule always succeeding" {
+    PACKCC_OPTS=(-O2)
+    test_generate "succeeding.peg"
+    test_compile -Werror=unused-variable
+}
+
+@test "Testing inline.d - code size [large character classes]" {
+    PACKCC_OPTS=(-O0)
+    test_generate "keywords.peg"
+    local n="$(wc -l < "$BATS_TEST_DIRNAME/parser.c")"
+    PACKCC_OPTS=(-O2)
+    test_generate "keywords.peg"
+    [ "$(wc -l < "$BATS_TEST_DIRNAME/parser.c")" -le $((n * 3 / 2)) ]
+    in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_Letter,"
+    in_source "pcc_apply_rule(ctx, pcc_evaluate_rule_UnicodeDigit,"
+    test_compile
+}
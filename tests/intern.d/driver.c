@@ -0,0 +1,26 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "parser.h"
+
+int main(int argc, char **argv) {
+    const int clear = (argc > 1 && strcmp(argv[1], "--clear") == 0) ? 1 : 0;
+    const char *ret = NULL;
+    size_t m = 0, n = 0;
+    pcc_stats_t s;
+    pcc_context_t *ctx = pcc_create(NULL);
+    while (pcc_parse(ctx, &ret)) {
+        if (m == 0) {
+            pcc_get_stats(ctx, &s);
+            m = s.memory_bytes;
+        }
+        else {
+            n += strlen(ret) + 1;
+        }
+        if (clear) pcc_clear_strings(ctx);
+    }
+    pcc_get_stats(ctx, &s);
+    printf("%s\n", (s.memory_bytes >= m + n) ? "grown" : (s.memory_bytes <= m + 256) ? "bounded" : "inconsistent");
+    pcc_destroy(ctx);
+    return 0;
+}
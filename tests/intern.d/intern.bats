@@ -0,0 +1,43 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing intern.d - generation" {
+    test_generate
+}
+
+@test "Testing intern.d - check code" {
+    in_source "pcc_string_table__intern(ctx, &ctx->strings, ctx->buffer.buf + capt->range.start"
+    in_source "pcc_ast__leave(ctx, &ctx->ast, ctx->buffer.buf, ctx->pos);"
+}
+
+@test "Testing intern.d - compilation" {
+    test_compile
+}
+
+@test "Testing intern.d - run" {
+    run_for_input "intern.d/input.txt"
+}
+
+@test "Testing intern.d - multiple lines" {
+    test_generate "lines.peg"
+    test_compile
+    run_for_input "intern.d/input_lines.txt"
+}
+
+@test "Testing intern.d - multiple lines with AddressSanitizer" {
+    test_generate "lines.peg"
+    if ! test_compile -fsanitize=address,undefined -fno-omit-frame-pointer &> /dev/null; then
+        skip "AddressSanitizer is not available"
+    fi
+    run_for_input "intern.d/input_lines.txt"
+}
+
+@test "Testing intern.d - streaming" {
+    test_generate "stream.peg"
+    ${CC:-cc} -I "$BATS_TEST_DIRNAME" "$BATS_TEST_DIRNAME/driver.c" "$BATS_TEST_DIRNAME/parser.c" -o "$BATS_TEST_DIRNAME/driver"
+    run "$BATS_TEST_DIRNAME/driver" < <(seq 1 5000 | sed 's/^/w/')
+    [ "$output" = "grown" ]
+    run "$BATS_TEST_DIRNAME/driver" --clear < <(seq 1 5000 | sed 's/^/w/')
+    [ "$output" = "bounded" ]
+}
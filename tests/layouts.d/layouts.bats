@@ -0,0 +1,26 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing layouts.d - generation" {
+    test_generate
+}
+
+@test "Testing layouts.d - check code" {
+    in_source "pcc_thunk_chunk__create(ctx, &ctx->thunk_chunk_recyclers[3], 1, 3)"
+}
+
+@test "Testing layouts.d - compilation" {
+    test_compile
+}
+
+@test "Testing layouts.d - run" {
+    run_for_input "layouts.d/input.txt"
+}
+
+@test "Testing layouts.d - run with AddressSanitizer" {
+    if ! test_compile -fsanitize=address,undefined -fno-omit-frame-pointer &> /dev/null; then
+        skip "AddressSanitizer is not available"
+    fi
+    run_for_input "layouts.d/input.txt"
+}
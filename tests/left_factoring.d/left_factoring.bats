@@ -0,0 +1,30 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing left_factoring.d - generation" {
+    test_generate
+}
+
+@test "Testing left_factoring.d - debug report" {
+    run "$PACKCC" --debug -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/input.peg"
+    [ "$status" -eq 0 ]
+    [[ "$output" == *"Pass 'left-factoring' transformed rule 'STMT':"* ]]
+    [[ "$output" != *"transformed rule 'LINE':"* ]]
+}
+
+@test "Testing left_factoring.d - compilation" {
+    test_compile
+}
+
+@test "Testing left_factoring.d - run" {
+    run_for_input "left_factoring.d/input.txt"
+}
+
+@test "Testing left_factoring.d - alternative emptied by factoring" {
+    run "$PACKCC" --debug -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/prefix.peg"
+    [ "$status" -eq 0 ]
+    [[ "$output" == *"Pass 'left-factoring' transformed rule 'LINE':"* ]]
+    ! in_source "/* unreachable codes omitted */"
+    test_compile -Werror=unused-variable
+}
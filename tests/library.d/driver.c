@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "packcc.h"
+
+static void output(void *data, const char *name, const char *text, size_t length) {
+    FILE *const f = fopen(name, "wb");
+    const char *const s = strrchr(name, '/');
+    if (f == NULL || fwrite(text, 1, length, f) != length) exit(1);
+    fclose(f);
+    printf("output: %s\n", s ? s + 1 : name);
+    (*(int *)data)++;
+}
+
+static void report(void *data, const packcc_diagnostic_t *diag) {
+    if (diag->name != NULL)
+        printf("error: %s:%lu:%lu: %s\n", diag->name, (unsigned long)diag->line, (unsigned long)diag->col, diag->message);
+    else
+        printf("error: %s\n", diag->message);
+    (*(int *)data)++;
+}
+
+int main(int argc, char **argv) {
+    static const char bad[] =
+        "start <- 'a' undefined\n"
+        "start <- 'b'\n"
+        "%value \"\"\n";
+    static char text[65536];
+    packcc_options_t opts;
+    packcc_sink_t sink, files;
+    int count = 0, r, i;
+    size_t n;
+    FILE *f;
+    if (argc < 3) return 1;
+    f = fopen(argv[1], "rb");
+    if (f == NULL) return 1;
+    n = fread(text, 1, sizeof(text), f);
+    fclose(f);
+    sink.output = output;
+    sink.report = report;
+    sink.data = &count;
+    r = packcc_generate("bad.peg", bad, strlen(bad), argv[2], NULL, &sink);
+    printf("status: %d\n", r);
+    packcc_options_init(&opts);
+    opts.level = 4;
+    r = packcc_generate("input.peg", text, n, argv[2], &opts, &sink);
+    printf("status: %d\n", r);
+    opts.level = 2;
+    for (i = 0; i < 2; i++) {
+        r = packcc_generate("input.peg", text, n, argv[2], &opts, &sink);
+        printf("status: %d\n", r);
+    }
+    files.output = NULL; /* writes the files */
+    files.report = report;
+    files.data = &count;
+    opts.split = 2;
+    r = packcc_generate("input.peg", text, n, "/nonexistent/parser", &opts, &files);
+    printf("status: %d\n", r);
+    printf("callbacks: %d\n", count);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing library.d - library compilation" {
+    ${CC:-cc} -DPCC_LIBRARY -I "$ROOTDIR/src" "$ROOTDIR/src/packcc.c" "$BATS_TEST_DIRNAME/driver.c" -o "$BATS_TEST_DIRNAME/driver"
+}
+
+@test "Testing library.d - generation" {
+    run "$BATS_TEST_DIRNAME/driver" "$BATS_TEST_DIRNAME/input.peg" "$BATS_TEST_DIRNAME/parser"
+    diff --strip-trailing-cr -uN "$BATS_TEST_DIRNAME/driver.txt" --label "driver.txt" <(echo "$output") --label "output"
+}
+
+@test "Testing library.d - generation with AddressSanitizer" {
+    if ! ${CC:-cc} -fsanitize=address,undefined -fno-omit-frame-pointer -DPCC_LIBRARY -I "$ROOTDIR/src" "$ROOTDIR/src/packcc.c" "$BATS_TEST_DIRNAME/driver.c" -o "$BATS_TEST_DIRNAME/driver" &> /dev/null; then
+        skip "AddressSanitizer is not available"
+    fi
+    run "$BATS_TEST_DIRNAME/driver" "$BATS_TEST_DIRNAME/input.peg" "$BATS_TEST_DIRNAME/parser"
+    diff --strip-trailing-cr -uN "$BATS_TEST_DIRNAME/driver.txt" --label "driver.txt" <(echo "$output") --label "output"
+}
+
+@test "Testing library.d - compilation" {
+    test_compile
+}
+
+@test "Testing library.d - run" {
+    run_for_input "library.d/input.txt"
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing lookahead.d - generation" {
+    PACKCC_OPTS=(-O0)
+    test_generate
+}
+
+@test "Testing lookahead.d - check code" {
+    in_source "pcc_lr_table__shift(ctx, &ctx->lrtable, ctx->lrtable.len);"
+}
+
+@test "Testing lookahead.d - compilation" {
+    test_compile
+}
+
+@test "Testing lookahead.d - run" {
+    run_for_input "lookahead.d/input.txt"
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing nesting.d - generation" {
+    test_generate
+}
+
+@test "Testing nesting.d - check code" {
+    in_source "const size_t base = stack->len;"
+    in_source "while (stack->len > base) {"
+}
+
+@test "Testing nesting.d - compilation" {
+    test_compile
+}
+
+@test "Testing nesting.d - run" {
+    run_for_input "nesting.d/input.txt"
+}
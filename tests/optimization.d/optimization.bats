@@ -0,0 +1,79 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+check_passes() { # usage: [LEVEL=N] check_passes PEG_FILE [PASS:RULE]...
+    local file="$1"
+    shift
+    run "$PACKCC" -O"${LEVEL:-2}" --debug -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/$file"
+    [ "$status" -eq 0 ]
+    diff -u <(printf '%s\n' "$@") <(echo "$output" | sed -n "s/^Pass '\(.*\)' transformed rule '\(.*\)':$/\1:\2/p")
+}
+
+@test "Testing optimization.d - predicate-simplification" {
+    check_passes "predicate.peg" "predicate-simplification:RULE"
+}
+
+@test "Testing optimization.d - check code [predicate]" {
+    in_source "if (pcc_get_char_as_utf32(ctx, NULL) > 0) goto"
+}
+
+@test "Testing optimization.d - quantifier-simplification" {
+    check_passes "quantifier.peg" "quantifier-simplification:RULE"
+}
+
+@test "Testing optimization.d - string-concatenation" {
+    check_passes "string.peg" "string-concatenation:RULE"
+}
+
+@test "Testing optimization.d - unreachable-alternative-elimination" {
+    check_passes "unreachable.peg" "unreachable-alternative-elimination:RULE"
+}
+
+@test "Testing optimization.d - redundant-capture-removal" {
+    LEVEL=3 check_passes "capture.peg" "redundant-capture-removal:RULE"
+}
+
+@test "Testing optimization.d - redundant-capture-removal [O2]" {
+    run "$PACKCC" -O2 --debug -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/capture.peg"
+    [ "$status" -eq 0 ]
+    [[ "$output" != *"Pass 'redundant-capture-removal'"* ]]
+}
+
+@test "Testing optimization.d - charclass-merging" {
+    check_passes "charclass.peg" "charclass-merging:RULE"
+}
+
+@test "Testing optimization.d - no optimization" {
+    run "$PACKCC" -O0 --debug -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/input.peg"
+    [ "$status" -eq 0 ]
+    [[ "$output" != *"transformed rule"* ]]
+}
+
+@test "Testing optimization.d - run [O0]" {
+    PACKCC_OPTS=(-O0)
+    test_generate
+    test_compile
+    run_for_input "optimization.d/input.txt"
+}
+
+@test "Testing optimization.d - run [O1]" {
+    PACKCC_OPTS=(-O1)
+    test_generate
+    test_compile
+    run_for_input "optimization.d/input.txt"
+}
+
+@test "Testing optimization.d - run [O2]" {
+    PACKCC_OPTS=(-O2)
+    test_generate
+    test_compile
+    run_for_input "optimization.d/input.txt"
+}
+
+@test "Testing optimization.d - run [O3]" {
+    PACKCC_OPTS=(-O3)
+    test_generate
+    test_compile
+    run_for_input "optimization.d/input.txt"
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing reset.d - generation" {
+    test_generate
+}
+
+@test "Testing reset.d - check code" {
+    in_header "void pcc_reset(pcc_context_t *ctx, const char **auxil);"
+    in_header "void pcc_trim(pcc_context_t *ctx);"
+}
+
+@test "Testing reset.d - compilation" {
+    test_compile
+}
+
+@test "Testing reset.d - run" {
+    run_for_input "reset.d/input.txt"
+}
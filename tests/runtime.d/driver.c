@@ -0,0 +1,16 @@
+#include <stdio.h>
+
+#include "parser.h"
+#include "words.h"
+
+int main(int argc, char **argv) {
+    const char *text = "gamma delta";
+    int ret;
+    pcc_context_t *ctx = pcc_create(NULL);
+    words_context_t *wctx = words_create(&text);
+    while (pcc_parse(ctx, &ret));
+    while (words_parse(wctx, &ret));
+    words_destroy(wctx);
+    pcc_destroy(ctx);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+compile_driver() {
+    ${CC:-cc} -I "$BATS_TEST_DIRNAME" "$BATS_TEST_DIRNAME/driver.c" "$BATS_TEST_DIRNAME/parser.c" "$BATS_TEST_DIRNAME/words.c" "$BATS_TEST_DIRNAME/runtime.c" -o "$BATS_TEST_DIRNAME/driver" "$@"
+}
+
+@test "Testing runtime.d - generation" {
+    PACKCC_OPTS=(--runtime=runtime)
+    test_generate
+    (cd "$BATS_TEST_DIRNAME" && "$PACKCC" --runtime=runtime -o words words.peg)
+}
+
+@test "Testing runtime.d - check code" {
+    in_source '#include "runtime.h"'
+    ! in_source 'pcc_thunk_chunk_t *pcc_thunk_chunk__create('
+    grep -Fq 'pcc_thunk_chunk_t *pcc_thunk_chunk__create(' "$BATS_TEST_DIRNAME/runtime.c"
+    grep -Fq '#define pcc_context__create runtime__context__create' "$BATS_TEST_DIRNAME/runtime.h"
+}
+
+@test "Testing runtime.d - compilation" {
+    compile_driver
+}
+
+@test "Testing runtime.d - run" {
+    run timeout 5s "$BATS_TEST_DIRNAME/driver" < "$BATS_TEST_DIRNAME/input.txt"
+    check_output "$BATS_TEST_DIRNAME/input.txt"
+}
+
+@test "Testing runtime.d - run with AddressSanitizer" {
+    if ! compile_driver -fsanitize=address,undefined -fno-omit-frame-pointer &> /dev/null; then
+        skip "AddressSanitizer is not available"
+    fi
+    run timeout 5s "$BATS_TEST_DIRNAME/driver" < "$BATS_TEST_DIRNAME/input.txt"
+    check_output "$BATS_TEST_DIRNAME/input.txt"
+}
+
+@test "Testing runtime.d - unchanged runtime" {
+    touch -d "2000-01-01" "$BATS_TEST_DIRNAME"/runtime.[ch]
+    (cd "$BATS_TEST_DIRNAME" && "$PACKCC" --runtime=runtime -o words words.peg)
+    [ -z "$(find "$BATS_TEST_DIRNAME" -name 'runtime.[ch]' -newer "$BATS_TEST_DIRNAME/input.peg")" ]
+}
+
+@test "Testing runtime.d - split parser" {
+    PACKCC_OPTS=(--runtime=runtime --split=2)
+    test_generate
+    compile_driver "$BATS_TEST_DIRNAME/parser.1.c" "$BATS_TEST_DIRNAME/parser.2.c"
+    run timeout 5s "$BATS_TEST_DIRNAME/driver" < "$BATS_TEST_DIRNAME/input.txt"
+    check_output "$BATS_TEST_DIRNAME/input.txt"
+}
+
+@test "Testing runtime.d - mismatched runtime" {
+    PACKCC_OPTS=(--runtime=runtime)
+    test_generate "mismatch.peg"
+    run ${CC:-cc} -I "$BATS_TEST_DIRNAME" -c "$BATS_TEST_DIRNAME/words.c" -o /dev/null
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"The runtime has been generated for another value type, auxiliary type, or directives"* ]]
+}
+
+@test "Testing runtime.d - invalid runtime name" {
+    run "$PACKCC" --runtime=run-time -o "$BATS_TEST_DIRNAME/parser" "$BATS_TEST_DIRNAME/input.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Invalid runtime name 'run-time'"* ]]
+}
@@ -0,0 +1,32 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing skip.d - generation" {
+    test_generate
+}
+
+@test "Testing skip.d - check code" {
+    in_source "pcc_skip_rule__(ctx)"
+    in_source "pcc_skip_rule_COMMENT(ctx)"
+}
+
+@test "Testing skip.d - compilation" {
+    test_compile
+}
+
+@test "Testing skip.d - run" {
+    run_for_input "skip.d/input.txt"
+}
+
+@test "Testing skip.d - recursive rule" {
+    run test_generate "recursive.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"Recursive rule '_' not allowed for %skip"* ]]
+}
+
+@test "Testing skip.d - rule with action" {
+    run test_generate "action.peg"
+    [ "$status" -ne 0 ]
+    [[ "$output" == *"not allowed in rule '_' for %skip"* ]]
+}
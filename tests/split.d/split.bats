@@ -0,0 +1,44 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing split.d - generation" {
+    PACKCC_OPTS=(--split=3)
+    test_generate
+}
+
+@test "Testing split.d - check code" {
+    in_source '#include "parser.private.h"'
+    grep -Fq '#include "parser.private.h"' "$BATS_TEST_DIRNAME/parser.3.c"
+    [ ! -e "$BATS_TEST_DIRNAME/parser.4.c" ]
+}
+
+@test "Testing split.d - compilation" {
+    test_compile "$BATS_TEST_DIRNAME/parser.1.c" "$BATS_TEST_DIRNAME/parser.2.c" "$BATS_TEST_DIRNAME/parser.3.c"
+}
+
+@test "Testing split.d - run" {
+    run_for_input "split.d/input.txt"
+}
+
+@test "Testing split.d - unchanged outputs" {
+    touch -d "2000-01-01" "$BATS_TEST_DIRNAME"/parser.*
+    PACKCC_OPTS=(--split=3)
+    test_generate
+    [ -z "$(find "$BATS_TEST_DIRNAME" -name 'parser.*' -newer "$BATS_TEST_DIRNAME/input.peg")" ]
+}
+
+@test "Testing split.d - fewer source files" {
+    PACKCC_OPTS=(--split=2)
+    test_generate
+    [ -e "$BATS_TEST_DIRNAME/parser.2.c" ]
+    [ ! -e "$BATS_TEST_DIRNAME/parser.3.c" ]
+    test_compile "$BATS_TEST_DIRNAME"/parser.*.c
+    run_for_input "split.d/input.txt"
+    PACKCC_OPTS=()
+    test_generate
+    [ ! -e "$BATS_TEST_DIRNAME/parser.1.c" ]
+    [ ! -e "$BATS_TEST_DIRNAME/parser.private.h" ]
+    test_compile
+    run_for_input "split.d/input.txt"
+}
@@ -0,0 +1,22 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing stats.d - generation" {
+    PACKCC_OPTS=(-O2)
+    test_generate
+}
+
+@test "Testing stats.d - check code" {
+    in_header "} pcc_stats_t;"
+    in_header "void pcc_get_stats(const pcc_context_t *ctx, pcc_stats_t *stats);"
+    in_source "ctx->stats.memo_hits++;"
+}
+
+@test "Testing stats.d - compilation" {
+    test_compile
+}
+
+@test "Testing stats.d - run" {
+    run_for_input "stats.d/input.txt"
+}
@@ -0,0 +1,21 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing steps.d - generation" {
+    test_generate
+}
+
+@test "Testing steps.d - check code" {
+    in_header "void pcc_set_step_limit(pcc_context_t *ctx, size_t limit);"
+    in_header "PCC_STATUS_STEP_LIMIT = -2"
+    in_header "PCC_STATUS_CANCELED = -3"
+}
+
+@test "Testing steps.d - compilation" {
+    test_compile
+}
+
+@test "Testing steps.d - run" {
+    run_for_input "steps.d/input.txt"
+}
@@ -0,0 +1,28 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing threads.d - generation" {
+    test_generate
+}
+
+@test "Testing threads.d - check code" {
+    in_header "PCC_STATUS_SYNTAX_ERROR = -5"
+    run grep -E "^ +static [^(]*;$" "$BATS_TEST_DIRNAME/parser.c"
+    [ "$status" -eq 1 ]
+}
+
+@test "Testing threads.d - compilation" {
+    test_compile -pthread
+}
+
+@test "Testing threads.d - run" {
+    run_for_input "threads.d/input.txt"
+}
+
+@test "Testing threads.d - run with ThreadSanitizer" {
+    if ! test_compile -pthread -fsanitize=thread &> /dev/null; then
+        skip "ThreadSanitizer is not available"
+    fi
+    run_for_input "threads.d/input.txt"
+}
@@ -0,0 +1,27 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing thunkless.d - generation" {
+    test_generate
+}
+
+@test "Testing thunkless.d - check code" {
+    in_source "return &ctx->void_chunk;"
+    in_source "if (!pcc_apply_rule(ctx, pcc_evaluate_rule_LIST, NULL, NULL)) goto"
+}
+
+@test "Testing thunkless.d - compilation" {
+    test_compile
+}
+
+@test "Testing thunkless.d - run" {
+    run_for_input "thunkless.d/input.txt"
+}
+
+@test "Testing thunkless.d - run [O0]" {
+    PACKCC_OPTS=(-O0)
+    test_generate
+    test_compile
+    run_for_input "thunkless.d/input.txt"
+}
@@ -0,0 +1,20 @@
+#!/usr/bin/env bats
+
+load "$TESTDIR/utils.sh"
+
+@test "Testing value_hooks.d - generation" {
+    test_generate
+}
+
+@test "Testing value_hooks.d - check code" {
+    in_source "PCC_VALUE_DESTROY(ctx->auxil, &chunk->values[chunk->valuec]);"
+    in_source "PCC_VALUE_MOVE(ctx->auxil, thunk->data.node.value, thunk->data.node.source);"
+}
+
+@test "Testing value_hooks.d - compilation" {
+    test_compile "-DRET_TYPE=char*"
+}
+
+@test "Testing value_hooks.d - run" {
+    run_for_input "value_hooks.d/input.txt"
+}